@@ -0,0 +1,42 @@
+# - Try to find OpenGL ES 2.0
+# Once done this will define
+#
+#  OPENGLES2_FOUND        - system has OpenGL ES 2.0
+#  OPENGLES2_INCLUDE_DIR  - the GLES2 include directory
+#  OPENGLES2_LIBRARIES    - Link these to use OpenGL ES 2.0
+
+FIND_PATH(OPENGLES2_INCLUDE_DIR GLES2/gl2.h
+  /usr/openwin/share/include
+  /opt/graphics/OpenGL/include
+  /usr/X11R6/include
+  /usr/include
+  /opt/vc/include
+)
+
+FIND_LIBRARY(OPENGLES2_gl_LIBRARY
+  NAMES GLESv2 brcmGLESv2
+  PATHS /opt/graphics/OpenGL/lib
+        /usr/openwin/lib
+        /usr/shlib
+        /usr/X11R6/lib
+        /usr/lib
+        /opt/vc/lib
+)
+
+SET( OPENGLES2_FOUND "NO" )
+IF(OPENGLES2_INCLUDE_DIR AND OPENGLES2_gl_LIBRARY)
+
+    SET( OPENGLES2_LIBRARIES ${OPENGLES2_gl_LIBRARY} )
+
+    SET( OPENGLES2_FOUND "YES" )
+
+ENDIF(OPENGLES2_INCLUDE_DIR AND OPENGLES2_gl_LIBRARY)
+
+IF(OpenGLES2_FIND_REQUIRED AND NOT OPENGLES2_FOUND)
+    MESSAGE(FATAL_ERROR "Could not find OpenGL ES 2.0")
+ENDIF(OpenGLES2_FIND_REQUIRED AND NOT OPENGLES2_FOUND)
+
+MARK_AS_ADVANCED(
+  OPENGLES2_INCLUDE_DIR
+  OPENGLES2_gl_LIBRARY
+)
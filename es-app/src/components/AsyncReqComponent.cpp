@@ -31,6 +31,7 @@ void AsyncReqComponent::update(int deltaTime)
 	}
 
 	mTime += deltaTime;
+	markDirty(); // the spinner moves every frame
 }
 
 void AsyncReqComponent::render(const Eigen::Affine3f& parentTrans)
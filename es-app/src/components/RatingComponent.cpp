@@ -6,8 +6,8 @@
 
 RatingComponent::RatingComponent(Window* window) : GuiComponent(window)
 {
-	mFilledTexture = TextureResource::get(":/star_filled.svg", true);
-	mUnfilledTexture = TextureResource::get(":/star_unfilled.svg", true);
+	mFilledTexture = TextureResource::get(":/star_filled.svg");
+	mUnfilledTexture = TextureResource::get(":/star_unfilled.svg");
 	mValue = 0.5f;
 	mSize << 64 * NUM_RATING_STARS, 64;
 	updateVertices();
@@ -27,6 +27,7 @@ void RatingComponent::setValue(const std::string& value)
 	}
 
 	updateVertices();
+	markDirty();
 }
 
 std::string RatingComponent::getValue() const
@@ -51,10 +52,11 @@ void RatingComponent::onSizeChanged()
 	if(mSize.y() > 0)
 	{
 		size_t heightPx = (size_t)round(mSize.y());
+		// rasterizations are shared, so we get different textures instead of changing these
 		if(filledSVG)
-			filledSVG->rasterizeAt(heightPx, heightPx);
+			mFilledTexture = filledSVG->getRasterized(heightPx, heightPx);
 		if(unfilledSVG)
-			unfilledSVG->rasterizeAt(heightPx, heightPx);
+			mUnfilledTexture = unfilledSVG->getRasterized(heightPx, heightPx);
 	}
 
 	updateVertices();
@@ -66,61 +68,60 @@ void RatingComponent::updateVertices()
 
 	const float h = round(getSize().y()); // is the same as a single star's width
 	const float w = round(h * mValue * numStars);
-	const float fw = round(h * numStars);
-
-	mVertices[0].pos << 0.0f, 0.0f;
-		mVertices[0].tex << 0.0f, 1.0f;
-	mVertices[1].pos << w, h;
-		mVertices[1].tex << mValue * numStars, 0.0f;
-	mVertices[2].pos << 0.0f, h;
-		mVertices[2].tex << 0.0f, 0.0f;
-
-	mVertices[3] = mVertices[0];
-	mVertices[4].pos << w, 0.0f;
-		mVertices[4].tex << mValue * numStars, 1.0f;
-	mVertices[5] = mVertices[1];
-
-	mVertices[6] = mVertices[4];
-	mVertices[7].pos << fw, h;
-		mVertices[7].tex << numStars, 0.0f;
-	mVertices[8] = mVertices[1];
-
-	mVertices[9] = mVertices[6];
-	mVertices[10].pos << fw, 0.0f;
-		mVertices[10].tex << numStars, 1.0f;
-	mVertices[11] = mVertices[7];
+
+	mVertexCount = 0;
+
+	// the filled part covers [0, w), the unfilled part [w, h * numStars)
+	for(int filled = 1; filled >= 0; filled--)
+	{
+		if(!filled)
+			mUnfilledVertexStart = mVertexCount;
+
+		const std::shared_ptr<TextureResource>& texture = filled ? mFilledTexture : mUnfilledTexture;
+
+		for(int i = 0; i < NUM_RATING_STARS; i++)
+		{
+			float left = i * h;
+			float right = left + h;
+			if(filled)
+				right = std::min(right, w);
+			else
+				left = std::max(left, w);
+
+			if(right <= left)
+				continue;
+
+			const Eigen::Vector2f texMin = texture->mapTexCoord(Eigen::Vector2f((left - i * h) / h, 0.0f));
+			const Eigen::Vector2f texMax = texture->mapTexCoord(Eigen::Vector2f((right - i * h) / h, 1.0f));
+
+			Renderer::Vertex* v = &mVertices[mVertexCount];
+			v[0].pos << left, 0.0f;
+				v[0].tex << texMin.x(), texMax.y();
+			v[1].pos << right, h;
+				v[1].tex << texMax.x(), texMin.y();
+			v[2].pos << left, h;
+				v[2].tex << texMin.x(), texMin.y();
+
+			v[3] = v[0];
+			v[4].pos << right, 0.0f;
+				v[4].tex << texMax.x(), texMax.y();
+			v[5] = v[1];
+
+			mVertexCount += 6;
+		}
+	}
 }
 
 void RatingComponent::render(const Eigen::Affine3f& parentTrans)
 {
-	Eigen::Affine3f trans = roundMatrix(parentTrans * getTransform());
+	Eigen::Affine3f trans = getWorldTransform(parentTrans, true);
 	Renderer::setMatrix(trans);
 
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	glColor4ub(255, 255, 255, getOpacity());
-
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-	
-	glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &mVertices[0].pos);
-	glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &mVertices[0].tex);
-	
-	mFilledTexture->bind();
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-
-	mUnfilledTexture->bind();
-	glDrawArrays(GL_TRIANGLES, 6, 6);
-
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	
-	glDisable(GL_TEXTURE_2D);
-	glDisable(GL_BLEND);
+	Renderer::buildVertexColors(mVertices, 0xFFFFFF00 | getOpacity(), mVertexCount);
 
-	glColor4ub(255, 255, 255, 255);
+	// both stars are usually on the same atlas page, the renderer puts them into one draw call then
+	Renderer::drawTriangles(mVertices, mUnfilledVertexStart, mFilledTexture->getTextureID());
+	Renderer::drawTriangles(&mVertices[mUnfilledVertexStart], mVertexCount - mUnfilledVertexStart, mUnfilledTexture->getTextureID());
 
 	renderChildren(trans);
 }
@@ -152,12 +153,12 @@ void RatingComponent::applyTheme(const std::shared_ptr<ThemeData>& theme, const
 	bool imgChanged = false;
 	if(properties & PATH && elem->has("filledPath"))
 	{
-		mFilledTexture = TextureResource::get(elem->get<std::string>("filledPath"), true);
+		mFilledTexture = TextureResource::get(elem->get<std::string>("filledPath"));
 		imgChanged = true;
 	}
 	if(properties & PATH && elem->has("unfilledPath"))
 	{
-		mUnfilledTexture = TextureResource::get(elem->get<std::string>("unfilledPath"), true);
+		mUnfilledTexture = TextureResource::get(elem->get<std::string>("unfilledPath"));
 		imgChanged = true;
 	}
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GuiComponent.h"
+#include "Renderer.h"
 #include "resources/TextureResource.h"
 
 #define NUM_RATING_STARS 5
@@ -32,11 +33,12 @@ private:
 
 	float mValue;
 
-	struct Vertex
-	{
-		Eigen::Vector2f pos;
-		Eigen::Vector2f tex;
-	} mVertices[12];
+	// every star gets its own quads (instead of tiling the textures), so the star textures can live in an atlas
+	// filled quads come first, unfilled ones start at mUnfilledVertexStart
+	Renderer::Vertex mVertices[NUM_RATING_STARS * 2 * 6];
+
+	int mUnfilledVertexStart;
+	int mVertexCount;
 
 	std::shared_ptr<TextureResource> mFilledTexture;
 	std::shared_ptr<TextureResource> mUnfilledTexture;
@@ -347,7 +347,7 @@ bool ScraperSearchComponent::input(InputConfig* config, Input input)
 
 void ScraperSearchComponent::render(const Eigen::Affine3f& parentTrans)
 {
-	Eigen::Affine3f trans = parentTrans * getTransform();
+	Eigen::Affine3f trans = getWorldTransform(parentTrans);
 
 	renderChildren(trans);
 
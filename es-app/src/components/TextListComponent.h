@@ -12,11 +12,15 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include <list>
+
+typedef std::list< std::shared_ptr<TextCache> > TextCacheList;
 
 struct TextListData
 {
 	unsigned int colorId;
-	std::shared_ptr<TextCache> textCache;
+	std::weak_ptr<TextCache> textCache; // owned by the list's mTextCaches, expires when evicted
+	TextCacheList::iterator textCacheIt; // only valid while textCache hasn't expired
 };
 
 //A graphical list. Supports multiple colors for rows and scrolling.
@@ -29,6 +33,7 @@ protected:
 	using IList<TextListData, T>::listInput;
 	using IList<TextListData, T>::listRenderTitleOverlay;
 	using IList<TextListData, T>::getTransform;
+	using IList<TextListData, T>::getWorldTransform;
 	using IList<TextListData, T>::mSize;
 	using IList<TextListData, T>::mCursor;
 	using IList<TextListData, T>::Entry;
@@ -61,15 +66,13 @@ public:
 	inline void setFont(const std::shared_ptr<Font>& font)
 	{
 		mFont = font;
-		for(auto it = mEntries.begin(); it != mEntries.end(); it++)
-			it->data.textCache.reset();
+		mTextCaches.clear();
 	}
 
 	inline void setUppercase(bool uppercase) 
 	{
 		mUppercase = true;
-		for(auto it = mEntries.begin(); it != mEntries.end(); it++)
-			it->data.textCache.reset();
+		mTextCaches.clear();
 	}
 
 	inline void setSelectorColor(unsigned int color) { mSelectorColor = color; }
@@ -84,9 +87,12 @@ protected:
 	virtual void onCursorChanged(const CursorState& state);
 
 private:
+	TextCache* getTextCache(typename IList<TextListData, T>::Entry& entry, size_t maxCaches);
+
 	static const int MARQUEE_DELAY = 2000;
 	static const int MARQUEE_SPEED = 8;
 	static const int MARQUEE_RATE = 1;
+	static const int MAX_TEXT_CACHES = 128; // or two screens worth, if that's more
 
 	int mMarqueeOffset;
 	int mMarqueeTime;
@@ -104,6 +110,9 @@ private:
 	std::shared_ptr<Sound> mScrollSound;
 	static const unsigned int COLOR_ID_COUNT = 2;
 	unsigned int mColors[COLOR_ID_COUNT];
+
+	// text caches of recently drawn entries, most recently drawn first
+	TextCacheList mTextCaches;
 };
 
 template <typename T>
@@ -128,7 +137,7 @@ TextListComponent<T>::TextListComponent(Window* window) :
 template <typename T>
 void TextListComponent<T>::render(const Eigen::Affine3f& parentTrans)
 {
-	Eigen::Affine3f trans = parentTrans * getTransform();
+	Eigen::Affine3f trans = getWorldTransform(parentTrans);
 	
 	std::shared_ptr<Font>& font = mFont;
 
@@ -164,12 +173,17 @@ void TextListComponent<T>::render(const Eigen::Affine3f& parentTrans)
 		Renderer::drawRect(0.f, (mCursor - startEntry)*entrySize + (entrySize - font->getHeight())/2, mSize.x(), font->getHeight(), mSelectorColor);
 	}
 
+	const size_t maxCaches = (size_t)(screenCount * 2 > MAX_TEXT_CACHES ? screenCount * 2 : MAX_TEXT_CACHES);
+
 	// clip to inside margins
 	Eigen::Vector3f dim(mSize.x(), mSize.y(), 0);
 	dim = trans * dim - trans.translation();
 	Renderer::pushClipRect(Eigen::Vector2i((int)(trans.translation().x() + mHorizontalMargin), (int)trans.translation().y()), 
 		Eigen::Vector2i((int)(dim.x() - mHorizontalMargin*2), (int)dim.y()));
 
+	// entries only differ by their offset, so only the translation is recalculated for each
+	Eigen::Affine3f drawTrans = trans;
+
 	for(int i = startEntry; i < listCutoff; i++)
 	{
 		typename IList<TextListData, T>::Entry& entry = mEntries.at((unsigned int)i);
@@ -180,10 +194,8 @@ void TextListComponent<T>::render(const Eigen::Affine3f& parentTrans)
 		else
 			color = mColors[entry.data.colorId];
 
-		if(!entry.data.textCache)
-			entry.data.textCache = std::unique_ptr<TextCache>(font->buildTextCache(mUppercase ? strToUpper(entry.name) : entry.name, 0, 0, 0x000000FF));
-
-		entry.data.textCache->setColor(color);
+		TextCache* textCache = getTextCache(entry, maxCaches);
+		textCache->setColor(color);
 
 		Eigen::Vector3f offset(0, y, 0);
 
@@ -193,12 +205,12 @@ void TextListComponent<T>::render(const Eigen::Affine3f& parentTrans)
 			offset[0] = mHorizontalMargin;
 			break;
 		case ALIGN_CENTER:
-			offset[0] = (mSize.x() - entry.data.textCache->metrics.size.x()) / 2;
+			offset[0] = (mSize.x() - textCache->metrics.size.x()) / 2;
 			if(offset[0] < 0)
 				offset[0] = 0;
 			break;
 		case ALIGN_RIGHT:
-			offset[0] = (mSize.x() - entry.data.textCache->metrics.size.x());
+			offset[0] = (mSize.x() - textCache->metrics.size.x());
 			offset[0] -= mHorizontalMargin;
 			if(offset[0] < 0)
 				offset[0] = 0;
@@ -208,11 +220,10 @@ void TextListComponent<T>::render(const Eigen::Affine3f& parentTrans)
 		if(mCursor == i)
 			offset[0] -= mMarqueeOffset;
 		
-		Eigen::Affine3f drawTrans = trans;
-		drawTrans.translate(offset);
+		drawTrans.translation() = trans * offset;
 		Renderer::setMatrix(drawTrans);
 
-		font->renderTextCache(entry.data.textCache.get());
+		font->renderTextCache(textCache);
 		
 		y += entrySize;
 	}
@@ -224,6 +235,25 @@ void TextListComponent<T>::render(const Eigen::Affine3f& parentTrans)
 	GuiComponent::renderChildren(trans);
 }
 
+template <typename T>
+TextCache* TextListComponent<T>::getTextCache(typename IList<TextListData, T>::Entry& entry, size_t maxCaches)
+{
+	if(!entry.data.textCache.expired())
+	{
+		mTextCaches.splice(mTextCaches.begin(), mTextCaches, entry.data.textCacheIt);
+		return mTextCaches.front().get();
+	}
+
+	// evicted caches give their vertex buffers back to TextCache's pool, the new one reuses them
+	while(mTextCaches.size() >= maxCaches)
+		mTextCaches.pop_back();
+
+	mTextCaches.push_front(std::shared_ptr<TextCache>(mFont->buildTextCache(mUppercase ? strToUpper(entry.name) : entry.name, 0, 0, 0x000000FF)));
+	entry.data.textCache = mTextCaches.front();
+	entry.data.textCacheIt = mTextCaches.begin();
+	return mTextCaches.front().get();
+}
+
 template <typename T>
 bool TextListComponent<T>::input(InputConfig* config, Input input)
 {
@@ -284,6 +314,7 @@ void TextListComponent<T>::update(int deltaTime)
 			{
 				mMarqueeOffset += MARQUEE_RATE;
 				mMarqueeTime -= MARQUEE_SPEED;
+				this->markDirty();
 			}
 		}
 	}
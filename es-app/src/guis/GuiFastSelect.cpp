@@ -99,6 +99,7 @@ void GuiFastSelect::update(int deltaTime)
 {
 	if(mScrollDir != 0)
 	{
+		markDirty(); // don't idle while the button is held, the next scroll step should happen on time
 		mScrollAccumulator += deltaTime;
 		while(mScrollAccumulator >= 150)
 		{
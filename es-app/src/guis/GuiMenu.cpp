@@ -112,6 +112,12 @@ GuiMenu::GuiMenu(Window* window) : GuiComponent(window), mMenu(window, "MAIN MEN
 			s->addWithLabel("SHOW FRAMERATE", framerate);
 			s->addSaveFunc([framerate] { Settings::getInstance()->setBool("DrawFramerate", framerate->getState()); });
 
+			// profiler, the slowest components in the framerate overlay and a trace when it's turned off
+			auto profiler = std::make_shared<SwitchComponent>(mWindow);
+			profiler->setState(Settings::getInstance()->getBool("Profiler"));
+			s->addWithLabel("PROFILER", profiler);
+			s->addSaveFunc([profiler] { Settings::getInstance()->setBool("Profiler", profiler->getState()); });
+
 			// show help
 			auto show_help = std::make_shared<SwitchComponent>(mWindow);
 			show_help->setState(Settings::getInstance()->getBool("ShowHelpPrompts"));
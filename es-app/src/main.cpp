@@ -16,7 +16,9 @@
 #include "Window.h"
 #include "EmulationStation.h"
 #include "Settings.h"
+#include "Profiler.h"
 #include "ScraperCmdLine.h"
+#include "resources/TextureDiskCache.h"
 #include <sstream>
 #include <boost/locale.hpp>
 
@@ -26,7 +28,10 @@
 
 namespace fs = boost::filesystem;
 
+#define IDLE_UPDATE_INTERVAL 100 // ms between updates while nothing is being drawn
+
 bool scrape_cmdline = false;
+bool warm_texture_cache = false;
 
 bool parseArgs(int argc, char* argv[], unsigned int* width, unsigned int* height)
 {
@@ -71,6 +76,9 @@ bool parseArgs(int argc, char* argv[], unsigned int* width, unsigned int* height
 		}else if(strcmp(argv[i], "--scrape") == 0)
 		{
 			scrape_cmdline = true;
+		}else if(strcmp(argv[i], "--warm-texture-cache") == 0)
+		{
+			warm_texture_cache = true;
 		}else if(strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
 		{
 #ifdef WIN32
@@ -93,6 +101,7 @@ bool parseArgs(int argc, char* argv[], unsigned int* width, unsigned int* height
 				"--no-exit			don't show the exit option in the menu\n"
 				"--debug				more logging, show console on Windows\n"
 				"--scrape			scrape using command line interface\n"
+				"--warm-texture-cache		decode and cache all game images, then quit\n"
 				"--windowed			not fullscreen, should be used with --resolution\n"
 				"--vsync [1/on or 0/off]		turn vsync on or off (default is on)\n"
 				"--help, -h			summon a sentient, angry tuba\n\n"
@@ -149,6 +158,57 @@ bool loadSystemConfigFile(const char** errorString)
 	return true;
 }
 
+// decodes every game image ahead of time so browsing never has to wait on the image decoder
+int warmTextureCache(unsigned int width, unsigned int height)
+{
+	// images are cached downscaled to fit the screen, so we need to know what size the screen will be
+	if(width == 0 || height == 0)
+	{
+		SDL_DisplayMode dispMode;
+		if(SDL_Init(SDL_INIT_VIDEO) != 0 || SDL_GetDesktopDisplayMode(0, &dispMode) != 0)
+		{
+			std::cerr << "Could not determine screen resolution (" << SDL_GetError() << "), use --resolution [width] [height].\n";
+			SDL_Quit();
+			return 1;
+		}
+		SDL_Quit();
+
+		if(width == 0)
+			width = dispMode.w;
+		if(height == 0)
+			height = dispMode.h;
+	}
+
+	const Eigen::Vector2i maxSize(width, height);
+	const char* metadataKeys[] = { "image", "thumbnail" };
+
+	unsigned int cached = 0;
+	unsigned int failed = 0;
+	for(auto sys = SystemData::sSystemVector.begin(); sys != SystemData::sSystemVector.end(); sys++)
+	{
+		std::cout << "Caching images for " << (*sys)->getName() << "...\n";
+
+		std::vector<FileData*> games = (*sys)->getRootFolder()->getFilesRecursive(GAME);
+		for(auto game = games.begin(); game != games.end(); game++)
+		{
+			for(unsigned int i = 0; i < sizeof(metadataKeys) / sizeof(metadataKeys[0]); i++)
+			{
+				const std::string& path = (*game)->metadata.get(metadataKeys[i]);
+				if(path.empty() || !TextureDiskCache::isCacheable(path))
+					continue;
+
+				if(TextureDiskCache::warm(path, maxSize))
+					cached++;
+				else
+					failed++;
+			}
+		}
+	}
+
+	std::cout << cached << " images cached in \"" << TextureDiskCache::getCacheDirectory() << "\" (" << failed << " failed).\n";
+	return 0;
+}
+
 //called on exit, assuming we get far enough to have the log initialized
 void onExit()
 {
@@ -214,7 +274,7 @@ int main(int argc, char* argv[])
 	ViewController::init(&window);
 	window.pushGui(ViewController::get());
 
-	if(!scrape_cmdline)
+	if(!scrape_cmdline && !warm_texture_cache)
 	{
 		if(!window.init(width, height))
 		{
@@ -229,6 +289,8 @@ int main(int argc, char* argv[])
 		window.renderLoadingScreen();
 	}
 
+	unsigned int startTime = SDL_GetTicks();
+
 	const char* errorMsg = NULL;
 	if(!loadSystemConfigFile(&errorMsg))
 	{
@@ -236,7 +298,7 @@ int main(int argc, char* argv[])
 		if(errorMsg == NULL)
 		{
 			LOG(LogError) << "Unknown error occured while parsing system config file.";
-			if(!scrape_cmdline)
+			if(!scrape_cmdline && !warm_texture_cache)
 				Renderer::deinit();
 			return 1;
 		}
@@ -251,18 +313,30 @@ int main(int argc, char* argv[])
 			}));
 	}
 
+	LOG(LogInfo) << "Loaded systems in " << SDL_GetTicks() - startTime << "ms";
+
 	//run the command line scraper then quit
 	if(scrape_cmdline)
 	{
 		return run_scraper_cmdline();
 	}
 
+	//fill the texture cache then quit
+	if(warm_texture_cache)
+	{
+		int ret = warmTextureCache(width, height);
+		SystemData::deleteSystems();
+		return ret;
+	}
+
 	//dont generate joystick events while we're loading (hopefully fixes "automatically started emulator" bug)
 	SDL_JoystickEventState(SDL_DISABLE);
 
 	// preload what we can right away instead of waiting for the user to select it
 	// this makes for no delays when accessing content, but a longer startup time
+	startTime = SDL_GetTicks();
 	ViewController::get()->preload();
+	LOG(LogInfo) << "Preloaded views in " << SDL_GetTicks() - startTime << "ms";
 
 	//choose which GUI to open depending on if an input configuration already exists
 	if(errorMsg == NULL)
@@ -278,13 +352,17 @@ int main(int argc, char* argv[])
 	//generate joystick events since we're done loading
 	SDL_JoystickEventState(SDL_ENABLE);
 
-	int lastTime = SDL_GetTicks();
+	FrameTimer& frameTimer = window.getFrameTimer();
+	frameTimer.reset();
 	bool running = true;
+	bool idle = false;
 
 	while(running)
 	{
+		// when nothing changed last frame we block until input arrives, but still update now and then for timers and downloads
 		SDL_Event event;
-		while(SDL_PollEvent(&event))
+		bool hasEvent = idle ? SDL_WaitEventTimeout(&event, IDLE_UPDATE_INTERVAL) : SDL_PollEvent(&event);
+		for(; hasEvent; hasEvent = SDL_PollEvent(&event))
 		{
 			switch(event.type)
 			{
@@ -300,6 +378,10 @@ int main(int argc, char* argv[])
 				case SDL_JOYDEVICEREMOVED:
 					InputManager::getInstance()->parseEvent(event, &window);
 					break;
+				case SDL_WINDOWEVENT:
+					// e.g. uncovered or restored while idle, what's on screen may be gone
+					window.markDirty();
+					break;
 				case SDL_QUIT:
 					running = false;
 					break;
@@ -308,26 +390,30 @@ int main(int argc, char* argv[])
 
 		if(window.isSleeping())
 		{
-			lastTime = SDL_GetTicks();
+			frameTimer.reset();
 			SDL_Delay(1); // this doesn't need to be accurate, we're just giving up our CPU time until something wakes us up
 			continue;
 		}
 
-		int curTime = SDL_GetTicks();
-		int deltaTime = curTime - lastTime;
-		lastTime = curTime;
+		window.update(frameTimer.tick(idle));
 
-		// cap deltaTime at 1000
-		if(deltaTime > 1000 || deltaTime < 0)
-			deltaTime = 1000;
+		// skip drawing frames that would look exactly like the last one
+		idle = !window.isDirty();
+		if(!idle)
+		{
+			window.render();
+			Renderer::swapBuffers();
 
-		window.update(deltaTime);
-		window.render();
-		Renderer::swapBuffers();
+			// without vsync nothing would stop us from drawing frames the display never shows
+			if(!Renderer::isVSyncEnabled())
+				frameTimer.waitForNextFrame();
+		}
 
 		Log::flush();
 	}
 
+	Profiler::shutdown();
+
 	while(window.peekGui() != ViewController::get())
 		delete window.peekGui();
 	window.deinit();
@@ -7,7 +7,9 @@
 #include "animations/LambdaAnimation.h"
 #include "SystemData.h"
 #include "Settings.h"
+#include "Profiler.h"
 #include "Util.h"
+#include <SDL.h>
 
 #define SELECTED_SCALE 1.5f
 #define LOGO_PADDING ((logoSize().x() * (SELECTED_SCALE - 1)/2) + (mSize.x() * 0.06f))
@@ -30,6 +32,8 @@ SystemView::SystemView(Window* window) : IList<SystemViewData, SystemData*>(wind
 
 void SystemView::populate()
 {
+	const unsigned int startTime = SDL_GetTicks();
+
 	mEntries.clear();
 
 	for(auto it = SystemData::sSystemVector.begin(); it != SystemData::sSystemVector.end(); it++)
@@ -80,6 +84,9 @@ void SystemView::populate()
 
 		this->add(e);
 	}
+
+	// SVG logos are only queued for rasterization here, the first frame picks them up
+	LOG(LogInfo) << "SystemView::populate() took " << SDL_GetTicks() - startTime << "ms for " << mEntries.size() << " systems";
 }
 
 void SystemView::goToSystem(SystemData* system, bool animate)
@@ -265,7 +272,17 @@ void SystemView::render(const Eigen::Affine3f& parentTrans)
 	if(mEntries.size() == 1)
 		logoCount = 1;
 
-	// draw background extras
+	// draw background extras, the ones sliding out of focus are drawn from a cache until the camera stops
+	const bool sliding = isAnimationPlaying(0);
+	if(!sliding)
+	{
+		for(auto it = mEntries.begin(); it != mEntries.end(); it++)
+		{
+			if(it->data.backgroundExtras->isRenderCached())
+				it->data.backgroundExtras->setRenderCached(false);
+		}
+	}
+
 	Eigen::Affine3f extrasTrans = trans;
 	int extrasCenter = (int)mExtrasCamOffset;
 	for(int i = extrasCenter - 1; i < extrasCenter + 2; i++)
@@ -279,8 +296,15 @@ void SystemView::render(const Eigen::Affine3f& parentTrans)
 		extrasTrans.translation() = trans.translation() + Eigen::Vector3f((i - mExtrasCamOffset) * mSize.x(), 0, 0);
 
 		Eigen::Vector2i clipRect = Eigen::Vector2i((int)((i - mExtrasCamOffset) * mSize.x()), 0);
+		const std::shared_ptr<ThemeExtras>& extras = mEntries.at(index).data.backgroundExtras;
+		if(sliding && extras->isRenderCached() != (index != mCursor))
+			extras->setRenderCached(index != mCursor);
+
 		Renderer::pushClipRect(clipRect, mSize.cast<int>());
-		mEntries.at(index).data.backgroundExtras->render(extrasTrans);
+		{
+			Profiler::Scope scope(Profiler::RENDER, extras.get());
+			extras->renderWithCache(extrasTrans);
+		}
 		Renderer::popClipRect();
 	}
 
@@ -315,11 +339,13 @@ void SystemView::render(const Eigen::Affine3f& parentTrans)
 			// selected
 			const std::shared_ptr<GuiComponent>& comp = mEntries.at(index).data.logoSelected;
 			comp->setOpacity(0xFF);
+			Profiler::Scope scope(Profiler::RENDER, comp.get());
 			comp->render(logoTrans);
 		}else{
 			// not selected
 			const std::shared_ptr<GuiComponent>& comp = mEntries.at(index).data.logo;
 			comp->setOpacity(0x80);
+			Profiler::Scope scope(Profiler::RENDER, comp.get());
 			comp->render(logoTrans);
 		}
 	}
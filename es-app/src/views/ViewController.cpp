@@ -2,6 +2,7 @@
 #include "Log.h"
 #include "SystemData.h"
 #include "Settings.h"
+#include "Profiler.h"
 
 #include "views/gamelist/BasicGameListView.h"
 #include "views/gamelist/DetailedGameListView.h"
@@ -276,12 +277,23 @@ void ViewController::update(int deltaTime)
 {
 	if(mCurrentView)
 	{
+		Profiler::Scope scope(Profiler::UPDATE, mCurrentView.get());
 		mCurrentView->update(deltaTime);
 	}
 
 	updateSelf(deltaTime);
 }
 
+// views the camera is sliding away from don't change, they're drawn from a cache until it stops
+static void renderView(GuiComponent* view, bool cached, const Eigen::Affine3f& trans)
+{
+	if(view->isRenderCached() != cached)
+		view->setRenderCached(cached);
+
+	Profiler::Scope scope(Profiler::RENDER, view);
+	view->renderWithCache(trans);
+}
+
 void ViewController::render(const Eigen::Affine3f& parentTrans)
 {
 	Eigen::Affine3f trans = mCamera * parentTrans;
@@ -290,8 +302,10 @@ void ViewController::render(const Eigen::Affine3f& parentTrans)
 	Eigen::Vector3f viewStart = trans.inverse().translation();
 	Eigen::Vector3f viewEnd = trans.inverse() * Eigen::Vector3f((float)Renderer::getScreenWidth(), (float)Renderer::getScreenHeight(), 0);
 
+	const bool sliding = isAnimationPlaying(0);
+
 	// draw systemview
-	getSystemListView()->render(trans);
+	renderView(getSystemListView().get(), sliding && mCurrentView != getSystemListView(), trans);
 	
 	// draw gamelists
 	for(auto it = mGameListViews.begin(); it != mGameListViews.end(); it++)
@@ -302,7 +316,9 @@ void ViewController::render(const Eigen::Affine3f& parentTrans)
 
 		if(guiEnd.x() >= viewStart.x() && guiEnd.y() >= viewStart.y() &&
 			guiStart.x() <= viewEnd.x() && guiStart.y() <= viewEnd.y())
-				it->second->render(trans);
+				renderView(it->second.get(), sliding && mCurrentView != it->second, trans);
+		else if(it->second->isRenderCached())
+			it->second->setRenderCached(false);
 	}
 
 	if(mWindow->peekGui() == this)
@@ -0,0 +1,100 @@
+#include "FrameTimer.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#define MAX_DELTA 1000.0 // ms, longer frames (e.g. loading something big) would throw animations too far ahead
+#define SNAP_TOLERANCE 1.0 // ms a frame may be off of a whole number of refreshes and still count as one
+
+// histogram buckets, in display refreshes
+static const double sBucketEdges[] = { 0.5, 0.9, 1.1, 1.5, 2.5, 3.5 };
+static const int sBucketCount = sizeof(sBucketEdges) / sizeof(sBucketEdges[0]) + 1;
+
+FrameTimer::FrameTimer() : mFrequency(SDL_GetPerformanceFrequency()), mLastCounter(SDL_GetPerformanceCounter()),
+	mRefreshPeriod(1000.0 / 60), mDebt(0), mRemainder(0), mHistoryCount(0), mHistoryPos(0)
+{
+}
+
+void FrameTimer::setRefreshRate(unsigned int refreshRate)
+{
+	if(refreshRate > 0)
+		mRefreshPeriod = 1000.0 / refreshRate;
+}
+
+double FrameTimer::getElapsed() const
+{
+	return (double)(SDL_GetPerformanceCounter() - mLastCounter) * 1000.0 / mFrequency;
+}
+
+int FrameTimer::tick(bool idle)
+{
+	double raw = getElapsed();
+	mLastCounter = SDL_GetPerformanceCounter();
+
+	double delta = std::min(raw, MAX_DELTA);
+	if(idle || raw >= MAX_DELTA)
+	{
+		mDebt = 0;
+	}else{
+		mHistory[mHistoryPos] = (float)raw;
+		mHistoryPos = (mHistoryPos + 1) % HISTORY_SIZE;
+		if(mHistoryCount < HISTORY_SIZE)
+			mHistoryCount++;
+
+		const double refreshes = round(raw / mRefreshPeriod);
+		if(refreshes >= 1 && fabs(raw - refreshes * mRefreshPeriod) < SNAP_TOLERANCE)
+			delta = refreshes * mRefreshPeriod;
+
+		// once snapping is off by more than a frame could be, catch up in one go
+		mDebt += raw - delta;
+		if(fabs(mDebt) > SNAP_TOLERANCE)
+		{
+			delta = std::max(delta + mDebt, 0.0);
+			mDebt = 0;
+		}
+	}
+
+	const double total = delta + mRemainder;
+	const int ms = (int)total;
+	mRemainder = total - ms;
+	return ms;
+}
+
+void FrameTimer::reset()
+{
+	mLastCounter = SDL_GetPerformanceCounter();
+	mDebt = 0;
+}
+
+void FrameTimer::waitForNextFrame()
+{
+	// no spinning for the last bit, it would keep a core busy every frame
+	// rounding down and SDL_Delay oversleeping roughly even out, and tick() snaps what's left over
+	const double remaining = mRefreshPeriod - getElapsed();
+	if(remaining >= 1)
+		SDL_Delay((Uint32)remaining);
+}
+
+std::string FrameTimer::getHistogram() const
+{
+	int counts[sBucketCount] = { 0 };
+	float worst = 0;
+	for(int i = 0; i < mHistoryCount; i++)
+	{
+		int bucket = 0;
+		while(bucket < sBucketCount - 1 && mHistory[i] >= sBucketEdges[bucket] * mRefreshPeriod)
+			bucket++;
+
+		counts[bucket]++;
+		worst = std::max(worst, mHistory[i]);
+	}
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(1) << "frame times: <" << sBucketEdges[0] * mRefreshPeriod << "ms " << counts[0];
+	for(int i = 1; i < sBucketCount - 1; i++)
+		ss << ", " << sBucketEdges[i - 1] * mRefreshPeriod << "-" << sBucketEdges[i] * mRefreshPeriod << "ms " << counts[i];
+	ss << ", >" << sBucketEdges[sBucketCount - 2] * mRefreshPeriod << "ms " << counts[sBucketCount - 1];
+	ss << " (worst " << worst << "ms)";
+	return ss.str();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <SDL.h>
+
+// Measures the time between frames with SDL's high resolution counter and hands out the delta times for Window::update().
+// Deltas are smoothed: times close to a whole number of display refreshes are snapped to it (vsync jitter would otherwise make
+// animations judder), the difference is paid back later and the sub-millisecond remainder is carried over, so no time gets lost.
+class FrameTimer
+{
+public:
+	FrameTimer();
+
+	void setRefreshRate(unsigned int refreshRate);
+
+	// Milliseconds since the last call. idle means we waited for input since then, that time isn't a frame time.
+	int tick(bool idle);
+
+	// Starts counting from now, e.g. after sleeping.
+	void reset();
+
+	// Sleeps until about a refresh has passed since the last tick(), for when swapping buffers doesn't wait for vsync.
+	void waitForNextFrame();
+
+	// A histogram of the recent frame times, for the framerate overlay.
+	std::string getHistogram() const;
+
+private:
+	double getElapsed() const; // in ms since the last tick()
+
+	Uint64 mFrequency;
+	Uint64 mLastCounter;
+	double mRefreshPeriod;
+
+	double mDebt; // time that snapping held back (or added)
+	double mRemainder; // the part of the last delta that didn't fit in whole milliseconds
+
+	static const int HISTORY_SIZE = 240;
+	float mHistory[HISTORY_SIZE];
+	int mHistoryCount;
+	int mHistoryPos;
+};
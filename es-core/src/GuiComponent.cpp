@@ -4,9 +4,19 @@
 #include "Renderer.h"
 #include "animations/AnimationController.h"
 #include "ThemeData.h"
+#include "Util.h"
+#include "resources/RenderTarget.h"
+#include "Profiler.h"
+#include <float.h>
+
+unsigned int GuiComponent::sCulledCount = 0;
+unsigned int GuiComponent::sLastFrameCulledCount = 0;
+std::set<GuiComponent*> GuiComponent::sRenderCaches;
 
 GuiComponent::GuiComponent(Window* window) : mWindow(window), mParent(NULL), mOpacity(255), 
-	mPosition(Eigen::Vector3f::Zero()), mSize(Eigen::Vector2f::Zero()), mTransform(Eigen::Affine3f::Identity())
+	mPosition(Eigen::Vector3f::Zero()), mSize(Eigen::Vector2f::Zero()), mTransform(Eigen::Affine3f::Identity()), mTransformDirty(false),
+	mWorldTransformDirty(true), mCullBoxDirty(true), mRenderCached(false), mRenderCacheValid(false),
+	mRenderCacheUsed(false)
 {
 	for(unsigned char i = 0; i < MAX_ANIMATIONS; i++)
 		mAnimationMap[i] = NULL;
@@ -23,6 +33,8 @@ GuiComponent::~GuiComponent()
 
 	for(unsigned int i = 0; i < getChildCount(); i++)
 		getChild(i)->setParent(NULL);
+
+	releaseRenderCache();
 }
 
 bool GuiComponent::input(InputConfig* config, Input input)
@@ -46,6 +58,7 @@ void GuiComponent::updateChildren(int deltaTime)
 {
 	for(unsigned int i = 0; i < getChildCount(); i++)
 	{
+		Profiler::Scope scope(Profiler::UPDATE, getChild(i));
 		getChild(i)->update(deltaTime);
 	}
 }
@@ -58,18 +71,80 @@ void GuiComponent::update(int deltaTime)
 
 void GuiComponent::render(const Eigen::Affine3f& parentTrans)
 {
-	Eigen::Affine3f trans = parentTrans * getTransform();
-	renderChildren(trans);
+	renderChildren(getWorldTransform(parentTrans));
 }
 
 void GuiComponent::renderChildren(const Eigen::Affine3f& transform) const
 {
+	const Eigen::Vector4f clipBounds = Renderer::getClipBounds();
 	for(unsigned int i = 0; i < getChildCount(); i++)
 	{
+		if(getChild(i)->cull(transform, clipBounds))
+			continue;
+
+		Profiler::Scope scope(Profiler::RENDER, getChild(i));
 		getChild(i)->render(transform);
 	}
 }
 
+Eigen::Vector4f GuiComponent::getLocalBounds() const
+{
+	return Eigen::Vector4f(0, 0, mSize.x(), mSize.y());
+}
+
+bool GuiComponent::cull(const Eigen::Affine3f& parentTrans, const Eigen::Vector4f& clipBounds)
+{
+	const Eigen::Vector4f bounds = getLocalBounds();
+	if(bounds[2] <= bounds[0] || bounds[3] <= bounds[1])
+		return false;
+
+	// the screen space box around our (possibly scaled) bounds, only recalculated when we or our bounds moved
+	// (render() gets the same parentTrans, so the world transform is shared with it)
+	const Eigen::Affine3f& trans = getWorldTransform(parentTrans);
+	if(mCullBoxDirty || mCullLocalBounds != bounds)
+	{
+		Eigen::Vector2f min(FLT_MAX, FLT_MAX);
+		Eigen::Vector2f max(-FLT_MAX, -FLT_MAX);
+		for(int corner = 0; corner < 4; corner++)
+		{
+			const Eigen::Vector3f point = trans * Eigen::Vector3f(bounds[(corner & 1) ? 2 : 0], bounds[(corner & 2) ? 3 : 1], 0);
+			min = min.cwiseMin(point.head<2>());
+			max = max.cwiseMax(point.head<2>());
+		}
+
+		mCullBox << min.x(), min.y(), max.x(), max.y();
+		mCullLocalBounds = bounds;
+		mCullBoxDirty = false;
+	}
+
+	if(mCullBox[2] > clipBounds[0] && mCullBox[0] < clipBounds[2] && mCullBox[3] > clipBounds[1] && mCullBox[1] < clipBounds[3])
+		return false;
+
+	sCulledCount++;
+	return true;
+}
+
+unsigned int GuiComponent::getCulledCount()
+{
+	return sLastFrameCulledCount;
+}
+
+void GuiComponent::endFrame()
+{
+	sLastFrameCulledCount = sCulledCount;
+	sCulledCount = 0;
+
+	// render targets are a whole screen each, only keep the ones still in use
+	for(auto it = sRenderCaches.begin(); it != sRenderCaches.end(); )
+	{
+		GuiComponent* cmp = *it++; // releasing removes it from the set
+		if(cmp->mRenderCacheUsed)
+			cmp->mRenderCacheUsed = false;
+		else
+			cmp->releaseRenderCache();
+	}
+}
+
 Eigen::Vector3f GuiComponent::getPosition() const
 {
 	return mPosition;
@@ -78,12 +153,16 @@ Eigen::Vector3f GuiComponent::getPosition() const
 void GuiComponent::setPosition(const Eigen::Vector3f& offset)
 {
 	mPosition = offset;
+	mTransformDirty = true;
+	markDirty();
 	onPositionChanged();
 }
 
 void GuiComponent::setPosition(float x, float y, float z)
 {
 	mPosition << x, y, z;
+	mTransformDirty = true;
+	markDirty();
 	onPositionChanged();
 }
 
@@ -95,12 +174,14 @@ Eigen::Vector2f GuiComponent::getSize() const
 void GuiComponent::setSize(const Eigen::Vector2f& size)
 {
     mSize = size;
+	markDirty();
     onSizeChanged();
 }
 
 void GuiComponent::setSize(float w, float h)
 {
 	mSize << w, h;
+	markDirty();
     onSizeChanged();
 }
 
@@ -108,6 +189,7 @@ void GuiComponent::setSize(float w, float h)
 void GuiComponent::addChild(GuiComponent* cmp)
 {
 	mChildren.push_back(cmp);
+	markDirty();
 
 	if(cmp->getParent())
 		cmp->getParent()->removeChild(cmp);
@@ -126,6 +208,7 @@ void GuiComponent::removeChild(GuiComponent* cmp)
 	}
 
 	cmp->setParent(NULL);
+	markDirty();
 
 	for(auto i = mChildren.begin(); i != mChildren.end(); i++)
 	{
@@ -140,6 +223,7 @@ void GuiComponent::removeChild(GuiComponent* cmp)
 void GuiComponent::clearChildren()
 {
 	mChildren.clear();
+	markDirty();
 }
 
 unsigned int GuiComponent::getChildCount() const
@@ -155,6 +239,7 @@ GuiComponent* GuiComponent::getChild(unsigned int i) const
 void GuiComponent::setParent(GuiComponent* parent)
 {
 	mParent = parent;
+	mWorldTransformDirty = true;
 }
 
 GuiComponent* GuiComponent::getParent() const
@@ -170,6 +255,7 @@ unsigned char GuiComponent::getOpacity() const
 void GuiComponent::setOpacity(unsigned char opacity)
 {
 	mOpacity = opacity;
+	markDirty();
 	for(auto it = mChildren.begin(); it != mChildren.end(); it++)
 	{
 		(*it)->setOpacity(opacity);
@@ -178,11 +264,35 @@ void GuiComponent::setOpacity(unsigned char opacity)
 
 const Eigen::Affine3f& GuiComponent::getTransform()
 {
-	mTransform.setIdentity();
-	mTransform.translate(mPosition);
+	if(mTransformDirty)
+	{
+		mTransform.setIdentity();
+		mTransform.translate(mPosition);
+		mTransformDirty = false;
+		mWorldTransformDirty = true;
+	}
+
 	return mTransform;
 }
 
+const Eigen::Affine3f& GuiComponent::getWorldTransform(const Eigen::Affine3f& parentTrans, bool rounded)
+{
+	const Eigen::Affine3f& trans = getTransform();
+
+	// comparing is a lot cheaper than multiplying, and most frames nothing moved
+	if(mWorldTransformDirty || mWorldParentTrans.matrix() != parentTrans.matrix())
+	{
+		mWorldParentTrans = parentTrans;
+		mWorldTransform = parentTrans * trans;
+		mRoundedWorldTransform = mWorldTransform;
+		roundMatrix(mRoundedWorldTransform);
+		mWorldTransformDirty = false;
+		mCullBoxDirty = true;
+	}
+
+	return rounded ? mRoundedWorldTransform : mWorldTransform;
+}
+
 void GuiComponent::setValue(const std::string& value)
 {
 }
@@ -206,6 +316,7 @@ void GuiComponent::setAnimation(Animation* anim, int delay, std::function<void()
 
 	AnimationController* oldAnim = mAnimationMap[slot];
 	mAnimationMap[slot] = new AnimationController(anim, delay, finishedCallback, reverse);
+	markDirty();
 
 	if(oldAnim)
 		delete oldAnim;
@@ -218,6 +329,7 @@ bool GuiComponent::stopAnimation(unsigned char slot)
 	{
 		delete mAnimationMap[slot];
 		mAnimationMap[slot] = NULL;
+		markDirty();
 		return true;
 	}else{
 		return false;
@@ -232,6 +344,7 @@ bool GuiComponent::cancelAnimation(unsigned char slot)
 		mAnimationMap[slot]->removeFinishedCallback();
 		delete mAnimationMap[slot];
 		mAnimationMap[slot] = NULL;
+		markDirty();
 		return true;
 	}else{
 		return false;
@@ -249,6 +362,7 @@ bool GuiComponent::finishAnimation(unsigned char slot)
 
 		delete mAnimationMap[slot]; // will also call finishedCallback
 		mAnimationMap[slot] = NULL;
+		markDirty();
 		return true;
 	}else{
 		return false;
@@ -261,7 +375,11 @@ bool GuiComponent::advanceAnimation(unsigned char slot, unsigned int time)
 	AnimationController* anim = mAnimationMap[slot];
 	if(anim)
 	{
+		// a running animation changes something every frame, one still waiting out its delay doesn't
 		bool done = anim->update(time);
+		if(done || anim->getTime() >= 0)
+			markDirty();
+
 		if(done)
 		{
 			mAnimationMap[slot] = NULL;
@@ -302,8 +420,98 @@ int GuiComponent::getAnimationTime(unsigned char slot) const
 	return mAnimationMap[slot]->getTime();
 }
 
+void GuiComponent::markDirty()
+{
+	// cached parents have to render us again
+	for(GuiComponent* cmp = this; cmp != NULL; cmp = cmp->mParent)
+		cmp->mRenderCacheValid = false;
+
+	mWindow->markDirty();
+}
+
+void GuiComponent::setRenderCached(bool cached)
+{
+	mRenderCached = cached;
+	mRenderCacheValid = false;
+	if(!cached)
+		releaseRenderCache();
+}
+
+void GuiComponent::releaseRenderCache()
+{
+	// the object stays, bind() makes the GL objects again if we're cached again
+	if(mRenderCache)
+		mRenderCache->deinit();
+
+	mRenderCacheValid = false;
+	mRenderCacheUsed = false;
+	sRenderCaches.erase(this);
+}
+
+void GuiComponent::renderWithCache(const Eigen::Affine3f& parentTrans)
+{
+	// the cache is drawn 1:1, anything scaled (e.g. the game launch zoom) is rendered the normal way
+	const Eigen::Affine3f trans = getWorldTransform(parentTrans, true);
+	if(!mRenderCached || !trans.linear().isIdentity() || !Renderer::hasRenderTargets())
+	{
+		render(parentTrans);
+		return;
+	}
+
+	if(!mRenderCache)
+		mRenderCache = RenderTarget::create();
+
+	if(!mRenderCacheValid || mRenderCache->getTextureID() == 0)
+	{
+		// this may be inside another component's cache pass, unbind() goes back to that one
+		if(!mRenderCache->bind())
+		{
+			render(parentTrans);
+			return;
+		}
+
+		sRenderCaches.insert(this);
+		Renderer::clear();
+
+		// render with our top left corner at the target's origin
+		Eigen::Affine3f origin = Eigen::Affine3f::Identity();
+		origin.translation() = -getTransform().translation();
+		render(origin);
+
+		mRenderCache->unbind();
+		mRenderCacheValid = true; // whatever render() marked dirty is in the cache already
+	}
+
+	const Eigen::Vector2f screen((float)Renderer::getScreenWidth(), (float)Renderer::getScreenHeight());
+	const Eigen::Vector2f size = mSize.isZero() ? screen : mSize.cwiseMin(screen);
+	const Eigen::Vector2f texSize(size.x() / screen.x(), size.y() / screen.y());
+
+	Renderer::Vertex verts[6];
+	verts[0].pos << 0, 0;
+	verts[1].pos << 0, size.y();
+	verts[2].pos << size.x(), 0;
+	verts[3].pos << size.x(), 0;
+	verts[4].pos << 0, size.y();
+	verts[5].pos << size.x(), size.y();
+
+	// GL's origin is the bottom left, the top row of the screen is the last one of the texture
+	verts[0].tex << 0, 1;
+	verts[1].tex << 0, 1 - texSize.y();
+	verts[2].tex << texSize.x(), 1;
+	verts[3].tex << texSize.x(), 1;
+	verts[4].tex << 0, 1 - texSize.y();
+	verts[5].tex << texSize.x(), 1 - texSize.y();
+
+	Renderer::buildVertexColors(verts, 0xFFFFFFFF, 6);
+	Renderer::setMatrix(trans);
+	Renderer::drawTriangles(verts, 6, mRenderCache->getTextureID(), GL_ONE, GL_ZERO);
+	mRenderCacheUsed = true;
+}
+
 void GuiComponent::applyTheme(const std::shared_ptr<ThemeData>& theme, const std::string& view, const std::string& element, unsigned int properties)
 {
+	mThemeElement = element;
+
 	Eigen::Vector2f scale = getParent() ? getParent()->getSize() : Eigen::Vector2f((float)Renderer::getScreenWidth(), (float)Renderer::getScreenHeight());
 
 	const ThemeData::ThemeElement* elem = theme->getElement(view, element, "");
@@ -2,6 +2,7 @@
 
 #include "InputConfig.h"
 #include <memory>
+#include <set>
 #include <Eigen/Dense>
 #include "HelpStyle.h"
 
@@ -10,6 +11,7 @@ class Animation;
 class AnimationController;
 class ThemeData;
 class Font;
+class RenderTarget;
 
 typedef std::pair<const char*, const char*> HelpPrompt;
 
@@ -28,9 +30,9 @@ public:
 	//Called when time passes.  Default implementation calls updateSelf(deltaTime) and updateChildren(deltaTime) - so you should probably call GuiComponent::update(deltaTime) at some point (or at least updateSelf so animations work).
 	virtual void update(int deltaTime);
 
-	//Called when it's time to render.  By default, just calls renderChildren(parentTrans * getTransform()).
+	//Called when it's time to render.  By default, just calls renderChildren(getWorldTransform(parentTrans)).
 	//You probably want to override this like so:
-	//1. Calculate the new transform that your control will draw at with Eigen::Affine3f t = parentTrans * getTransform().
+	//1. Calculate the new transform that your control will draw at with Eigen::Affine3f t = getWorldTransform(parentTrans).
 	//2. Set the renderer to use that new transform as the model matrix - Renderer::setMatrix(t);
 	//3. Draw your component.
 	//4. Tell your children to render, based on your component's transform - renderChildren(t).
@@ -72,6 +74,9 @@ public:
 
 	const Eigen::Affine3f& getTransform();
 
+	// parentTrans * getTransform() (run through roundMatrix if rounded), only calculated again when our position or parentTrans changed.
+	const Eigen::Affine3f& getWorldTransform(const Eigen::Affine3f& parentTrans, bool rounded = false);
+
 	virtual std::string getValue() const;
 	virtual void setValue(const std::string& value);
 
@@ -81,6 +86,7 @@ public:
 	// Default implementation just handles <pos> and <size> tags as normalized float pairs.
 	// You probably want to keep this behavior for any derived classes as well as add your own.
 	virtual void applyTheme(const std::shared_ptr<ThemeData>& theme, const std::string& view, const std::string& element, unsigned int properties);
+	inline const std::string& getThemeElement() const { return mThemeElement; } // the element last applied, for telling components apart in the profiler
 
 	// Returns a list of help prompts.
 	virtual std::vector<HelpPrompt> getHelpPrompts() { return std::vector<HelpPrompt>(); };
@@ -90,6 +96,26 @@ public:
 	
 	virtual HelpStyle getHelpStyle();
 
+	// Tells the window something visible changed. The screen is only drawn again after something did.
+	void markDirty();
+
+	// Opt-in: renderWithCache() renders this subtree into an offscreen texture once, then only draws that until something in it calls markDirty().
+	// The cache covers our size (or the whole screen without one) and replaces the cleared screen below it, so it's meant for things that
+	// cover their area and don't change while they're shown, like views sliding by. Turning it off frees the texture, and so does a frame
+	// that doesn't draw us through the cache (off screen, or the slide ended and we're drawn normally again).
+	void setRenderCached(bool cached);
+	inline bool isRenderCached() const { return mRenderCached; }
+	void renderWithCache(const Eigen::Affine3f& parentTrans); // render(), through the cache when it's turned on
+
+	// The area render() draws into, in our own space (min x, min y, max x, max y). From (0, 0) to our size unless overridden.
+	virtual Eigen::Vector4f getLocalBounds() const;
+
+	// True if render(parentTrans) can't draw anything visible, with our bounds entirely outside clipBounds (see Renderer::getClipBounds()).
+	// Our children are assumed to be inside our bounds. Components without a size could be drawing anywhere, they're never culled.
+	bool cull(const Eigen::Affine3f& parentTrans, const Eigen::Vector4f& clipBounds);
+	static unsigned int getCulledCount(); // components culled during the last frame
+	static void endFrame(); // called by Window::render()
+
 protected:
 	void renderChildren(const Eigen::Affine3f& transform) const;
 	void updateSelf(int deltaTime); // updates animations
@@ -104,10 +130,35 @@ protected:
 	Eigen::Vector3f mPosition;
 	Eigen::Vector2f mSize;
 
+	std::string mThemeElement;
+
 public:
 	const static unsigned char MAX_ANIMATIONS = 4;
 
 private:
 	Eigen::Affine3f mTransform; //Don't access this directly! Use getTransform()!
+	bool mTransformDirty;
+
+	// result of the last getWorldTransform() call (both ways, render() and renderWithCache() may ask differently) and what it was calculated from
+	Eigen::Affine3f mWorldTransform;
+	Eigen::Affine3f mRoundedWorldTransform;
+	Eigen::Affine3f mWorldParentTrans;
+	bool mWorldTransformDirty;
+
+	// screen space box for cull(), from the world transform and the local bounds it was calculated with
+	Eigen::Vector4f mCullBox;
+	Eigen::Vector4f mCullLocalBounds;
+	bool mCullBoxDirty;
+
+	bool mRenderCached;
+	bool mRenderCacheValid;
+	bool mRenderCacheUsed; // drawn from since the last endFrame()
+	std::shared_ptr<RenderTarget> mRenderCache;
+	void releaseRenderCache();
+
 	AnimationController* mAnimationMap[MAX_ANIMATIONS];
+
+	static unsigned int sCulledCount;
+	static unsigned int sLastFrameCulledCount;
+	static std::set<GuiComponent*> sRenderCaches; // the components that have a render target, see endFrame()
 };
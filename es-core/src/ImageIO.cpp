@@ -79,15 +79,57 @@ std::vector<unsigned char> ImageIO::loadFromMemoryRGBA32(const unsigned char * d
 
 void ImageIO::flipPixelsVert(unsigned char* imagePx, const size_t& width, const size_t& height)
 {
-	unsigned int temp;
-	unsigned int* arr = (unsigned int*)imagePx;
+	// swap whole rows at once
+	const size_t rowSize = width * 4;
+	std::vector<unsigned char> temp(rowSize);
 	for(size_t y = 0; y < height / 2; y++)
 	{
-		for(size_t x = 0; x < width; x++)
+		unsigned char* top = imagePx + y * rowSize;
+		unsigned char* bottom = imagePx + (height - y - 1) * rowSize;
+		memcpy(temp.data(), top, rowSize);
+		memcpy(top, bottom, rowSize);
+		memcpy(bottom, temp.data(), rowSize);
+	}
+}
+
+std::vector<unsigned char> ImageIO::scaleRGBA32(const unsigned char* data, size_t width, size_t height, size_t newWidth, size_t newHeight)
+{
+	std::vector<unsigned char> scaled(newWidth * newHeight * 4);
+
+	for(size_t y = 0; y < newHeight; y++)
+	{
+		// source rows covered by this destination row
+		const size_t y0 = y * height / newHeight;
+		size_t y1 = (y + 1) * height / newHeight;
+		if(y1 <= y0)
+			y1 = y0 + 1;
+
+		for(size_t x = 0; x < newWidth; x++)
 		{
-			temp = arr[x + (y * width)];
-			arr[x + (y * width)] = arr[x + (height * width) - ((y + 1) * width)];
-			arr[x + (height * width) - ((y + 1) * width)] = temp;
+			const size_t x0 = x * width / newWidth;
+			size_t x1 = (x + 1) * width / newWidth;
+			if(x1 <= x0)
+				x1 = x0 + 1;
+
+			unsigned int sum[4] = { 0, 0, 0, 0 };
+			for(size_t sy = y0; sy < y1; sy++)
+			{
+				const unsigned char* px = data + (sy * width + x0) * 4;
+				for(size_t sx = x0; sx < x1; sx++, px += 4)
+				{
+					sum[0] += px[0];
+					sum[1] += px[1];
+					sum[2] += px[2];
+					sum[3] += px[3];
+				}
+			}
+
+			const unsigned int count = (unsigned int)((y1 - y0) * (x1 - x0));
+			unsigned char* out = scaled.data() + (y * newWidth + x) * 4;
+			for(int c = 0; c < 4; c++)
+				out[c] = (unsigned char)(sum[c] / count);
 		}
 	}
+
+	return scaled;
 }
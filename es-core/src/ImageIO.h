@@ -8,4 +8,7 @@ class ImageIO
 public:
 	static std::vector<unsigned char> loadFromMemoryRGBA32(const unsigned char * data, const size_t size, size_t & width, size_t & height);
 	static void flipPixelsVert(unsigned char* imagePx, const size_t& width, const size_t& height);
+
+	// Box-filters an RGBA32 image down to newWidth x newHeight. Meant for downscaling only.
+	static std::vector<unsigned char> scaleRGBA32(const unsigned char* data, size_t width, size_t height, size_t newWidth, size_t newHeight);
 };
\ No newline at end of file
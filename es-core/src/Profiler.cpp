@@ -0,0 +1,255 @@
+#include "Profiler.h"
+#include "GuiComponent.h"
+#include "Renderer.h"
+#include "Settings.h"
+#include "platform.h"
+#include "Log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <typeindex>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+#define MAX_TRACE_EVENTS 500000 // about 16MB, a minute or so of a busy view. Past that only the overlay keeps going.
+#define REPORT_SIZE 8 // components listed in the overlay
+
+bool Profiler::sEnabled = false;
+Uint64 Profiler::sStartCounter = 0;
+std::set<std::string> Profiler::sNames;
+std::unordered_map<const GuiComponent*, Profiler::ComponentName> Profiler::sComponentNames;
+std::vector<Profiler::OpenScope> Profiler::sOpen;
+std::vector<Profiler::TraceEvent> Profiler::sEvents;
+std::map<Profiler::Key, Profiler::Stats> Profiler::sStats;
+unsigned int Profiler::sFrameCount = 0;
+double Profiler::sGPUTime = 0;
+unsigned int Profiler::sGPUFrameCount = 0;
+
+static const std::string& getTypeName(const GuiComponent* component)
+{
+	static std::map<std::type_index, std::string> names;
+
+	const std::type_info& type = typeid(*component);
+	auto it = names.find(type);
+	if(it != names.end())
+		return it->second;
+
+	std::string name = type.name();
+#ifdef __GNUC__
+	int status = 0;
+	char* demangled = abi::__cxa_demangle(type.name(), NULL, NULL, &status);
+	if(status == 0)
+		name = demangled;
+	free(demangled);
+#else
+	// MSVC's names are readable already, just without the "class "
+	if(name.compare(0, 6, "class ") == 0)
+		name = name.substr(6);
+#endif
+
+	return names.insert(std::make_pair(std::type_index(type), name)).first->second;
+}
+
+static std::string escapeJSON(const std::string& str)
+{
+	std::string escaped;
+	for(auto it = str.begin(); it != str.end(); it++)
+	{
+		if(*it == '"' || *it == '\\')
+		{
+			escaped += '\\';
+			escaped += *it;
+		}else if((unsigned char)*it < 0x20)
+		{
+			// control characters aren't allowed in JSON strings
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", (unsigned char)*it);
+			escaped += code;
+		}else{
+			escaped += *it;
+		}
+	}
+
+	return escaped;
+}
+
+double Profiler::getTime(Uint64 counter)
+{
+	return (double)(counter - sStartCounter) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+const std::string* Profiler::getName(const GuiComponent* component)
+{
+	const std::type_info& type = typeid(*component);
+	const std::string& themeElement = component->getThemeElement();
+
+	// the usual case, nothing is allocated
+	auto it = sComponentNames.find(component);
+	if(it != sComponentNames.end() && *it->second.type == type && it->second.themeElement == themeElement)
+		return it->second.name;
+
+	std::string name = getTypeName(component);
+	if(!themeElement.empty())
+		name += " (" + themeElement + ")";
+
+	ComponentName& componentName = sComponentNames[component];
+	componentName.type = &type;
+	componentName.themeElement = themeElement;
+	componentName.name = &(*sNames.insert(name).first);
+	return componentName.name;
+}
+
+void Profiler::begin(Pass pass, const GuiComponent* component)
+{
+	OpenScope scope;
+	scope.key = Key(pass, getName(component));
+	scope.childTime = 0;
+	sOpen.push_back(scope);
+
+	// last, so the bookkeeping above isn't part of it
+	sOpen.back().start = SDL_GetPerformanceCounter();
+}
+
+void Profiler::end()
+{
+	const Uint64 now = SDL_GetPerformanceCounter();
+	const OpenScope scope = sOpen.back();
+	sOpen.pop_back();
+
+	const double start = getTime(scope.start);
+	const double duration = getTime(now) - start;
+	if(!sOpen.empty())
+		sOpen.back().childTime += duration;
+
+	Stats& stats = sStats[scope.key];
+	stats.selfTime += duration - scope.childTime;
+	stats.totalTime += duration;
+	stats.calls++;
+
+	if(sEvents.size() < MAX_TRACE_EVENTS)
+	{
+		TraceEvent event = { scope.key, start, duration };
+		sEvents.push_back(event);
+		if(sEvents.size() == MAX_TRACE_EVENTS)
+			LOG(LogWarning) << "Profiler trace is full, only the overlay keeps updating";
+	}
+}
+
+void Profiler::beginFrame()
+{
+	const bool enabled = Settings::getInstance()->getBool("Profiler");
+	if(enabled != sEnabled)
+		setEnabled(enabled);
+
+	if(!sEnabled)
+		return;
+
+	sFrameCount++;
+
+	const float gpuTime = Renderer::getGPUFrameTime();
+	if(gpuTime >= 0)
+	{
+		sGPUTime += gpuTime;
+		sGPUFrameCount++;
+
+		if(sEvents.size() < MAX_TRACE_EVENTS)
+		{
+			TraceEvent event = { Key(RENDER, NULL), getTime(SDL_GetPerformanceCounter()), gpuTime };
+			sEvents.push_back(event);
+		}
+	}
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+	if(!enabled)
+		writeTrace();
+
+	sEnabled = enabled;
+	sStartCounter = SDL_GetPerformanceCounter();
+	sOpen.clear();
+	std::vector<TraceEvent>().swap(sEvents); // gives the memory back
+	sStats.clear();
+	sComponentNames.clear();
+	sNames.clear();
+	sFrameCount = 0;
+	sGPUTime = 0;
+	sGPUFrameCount = 0;
+
+	Renderer::setGPUTimerEnabled(enabled);
+}
+
+std::string Profiler::getReport()
+{
+	if(sFrameCount == 0)
+		return "";
+
+	std::vector< std::pair<Key, Stats> > slowest(sStats.begin(), sStats.end());
+	std::sort(slowest.begin(), slowest.end(), [](const std::pair<Key, Stats>& a, const std::pair<Key, Stats>& b) { return a.second.selfTime > b.second.selfTime; });
+	if(slowest.size() > REPORT_SIZE)
+		slowest.resize(REPORT_SIZE);
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(2);
+	if(sGPUFrameCount > 0)
+		ss << "GPU: " << sGPUTime / sGPUFrameCount << "ms";
+	else
+		ss << "GPU: no timer";
+
+	ss << "\nslowest (ms per frame, self/with children):";
+	for(auto it = slowest.begin(); it != slowest.end(); it++)
+	{
+		ss << "\n" << (it->first.first == UPDATE ? "update " : "render ") << *it->first.second << ": " <<
+			it->second.selfTime / sFrameCount << "/" << it->second.totalTime / sFrameCount;
+	}
+
+	sStats.clear();
+	sFrameCount = 0;
+	sGPUTime = 0;
+	sGPUFrameCount = 0;
+
+	return ss.str();
+}
+
+void Profiler::shutdown()
+{
+	if(sEnabled)
+		writeTrace();
+}
+
+void Profiler::writeTrace()
+{
+	if(sEvents.empty())
+		return;
+
+	const std::string path = getHomePath() + "/.emulationstation/es_trace.json";
+	std::ofstream file(path.c_str(), std::ios::trunc);
+	if(!file.is_open())
+	{
+		LOG(LogError) << "Error writing profiler trace to \"" << path << "\"!";
+		return;
+	}
+
+	// times are in microseconds, updates and renders get a row each
+	file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+	for(auto it = sEvents.begin(); it != sEvents.end(); it++)
+	{
+		if(it != sEvents.begin())
+			file << ",\n";
+
+		if(it->key.second == NULL)
+		{
+			file << "{\"name\":\"GPU frame (ms)\",\"ph\":\"C\",\"ts\":" << it->start * 1000 << ",\"pid\":1,\"args\":{\"ms\":" << it->value << "}}";
+		}else{
+			file << "{\"name\":\"" << escapeJSON(*it->key.second) << "\",\"cat\":\"" << (it->key.first == UPDATE ? "update" : "render") <<
+				"\",\"ph\":\"X\",\"ts\":" << it->start * 1000 << ",\"dur\":" << it->value * 1000 << ",\"pid\":1,\"tid\":" << (it->key.first == UPDATE ? 1 : 2) << "}";
+		}
+	}
+	file << "\n]}\n";
+
+	LOG(LogInfo) << "Wrote " << sEvents.size() << " profiler events to \"" << path << "\"";
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <typeinfo>
+#include <unordered_map>
+#include <SDL.h>
+
+class GuiComponent;
+
+// Opt-in timing (the "Profiler" setting) of GuiComponent::update() and render() per component type and theme element, and of whole frames on the GPU.
+// The components taking the most time show up in the framerate overlay. Everything recorded is also written to a Chrome trace
+// (~/.emulationstation/es_trace.json, open it in chrome://tracing) when profiling is turned off or ES quits.
+class Profiler
+{
+public:
+	enum Pass
+	{
+		UPDATE,
+		RENDER
+	};
+
+	// Times a component's update()/render() call, including its children, while it's in scope.
+	class Scope
+	{
+	public:
+		inline Scope(Pass pass, const GuiComponent* component) : mActive(sEnabled) { if(mActive) Profiler::begin(pass, component); }
+		inline ~Scope() { if(mActive) Profiler::end(); }
+
+	private:
+		bool mActive;
+	};
+
+	static inline bool isEnabled() { return sEnabled; }
+
+	static void beginFrame(); // picks up changes to the setting, called by Window::update()
+	static std::string getReport(); // the slowest components since the last report, averaged per frame
+	static void shutdown(); // writes the trace if we're profiling
+
+private:
+	typedef std::pair<Pass, const std::string*> Key; // the name points into sNames
+
+	struct Stats
+	{
+		Stats() : selfTime(0), totalTime(0), calls(0) {}
+
+		double selfTime; // ms, without the time spent in timed children
+		double totalTime; // ms
+		unsigned int calls;
+	};
+
+	struct OpenScope
+	{
+		Key key;
+		Uint64 start;
+		double childTime; // ms
+	};
+
+	struct TraceEvent
+	{
+		Key key; // no name for a GPU frame time
+		double start; // ms since profiling started
+		double value; // duration in ms, or the GPU frame time
+	};
+
+	// what a component was named after, so its name only has to be built again if that changed (or the address was reused)
+	struct ComponentName
+	{
+		const std::type_info* type;
+		std::string themeElement;
+		const std::string* name; // points into sNames
+	};
+
+	static const std::string* getName(const GuiComponent* component);
+
+	static void begin(Pass pass, const GuiComponent* component);
+	static void end();
+
+	static void setEnabled(bool enabled);
+	static void writeTrace();
+	static double getTime(Uint64 counter); // ms since profiling started
+
+	static bool sEnabled;
+	static Uint64 sStartCounter;
+
+	static std::set<std::string> sNames;
+	static std::unordered_map<const GuiComponent*, ComponentName> sComponentNames;
+	static std::vector<OpenScope> sOpen;
+	static std::vector<TraceEvent> sEvents;
+
+	// since the last report
+	static std::map<Key, Stats> sStats;
+	static unsigned int sFrameCount;
+	static double sGPUTime;
+	static unsigned int sGPUFrameCount;
+};
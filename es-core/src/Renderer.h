@@ -21,16 +21,84 @@ namespace Renderer
 	unsigned int getScreenWidth();
 	unsigned int getScreenHeight();
 
-	void buildGLColorArray(GLubyte* ptr, unsigned int color, unsigned int vertCount);
-
 	//graphics commands
 	void swapBuffers();
+	unsigned int getRefreshRate(); // of the display the window is on, 60 when SDL doesn't know it
+	bool isVSyncEnabled(); // if swapBuffers() waits for the display
 
 	void pushClipRect(Eigen::Vector2i pos, Eigen::Vector2i dim);
 	void popClipRect();
+	Eigen::Vector4f getClipBounds(); // what can be drawn to, in screen space (min x, min y, max x, max y): the current clip rect or the whole screen
 
 	void setMatrix(float* mat);
 	void setMatrix(const Eigen::Affine3f& transform);
+	const Eigen::Affine3f& getMatrix(); // the last matrix given to setMatrix
+
+	struct Vertex
+	{
+		Eigen::Vector2f pos;
+		Eigen::Vector2f tex;
+		GLubyte color[4];
+	};
+
+	enum Shader
+	{
+		SHADER_DEFAULT, // the vertex color, times the texture if there is one
+		SHADER_ALPHA_TEXTURE, // the vertex color, times the alpha of an alpha-only texture (bitmap glyphs)
+		SHADER_SDF // the vertex color, with the alpha taken from the distance field in the texture (SDF glyphs)
+	};
+
+	void buildVertexColors(Vertex* verts, unsigned int color, unsigned int vertCount);
+
+	// Queues up triangles in the space of the current matrix, they're drawn by flush().
+	// Draws with the same texture (0 for none), blending and shader go into one draw call, also across other draws as long as those don't overlap them.
+	void drawTriangles(const Vertex* verts, unsigned int count, GLuint texture, GLenum blend_sfactor = GL_SRC_ALPHA, GLenum blend_dfactor = GL_ONE_MINUS_SRC_ALPHA, Shader shader = SHADER_DEFAULT);
+	void drawLines(const Vertex* verts, unsigned int count); // not batched, draws right away
+
+	// draws everything queued up, called when the clip rect changes, when a texture that might be queued changes and before swapping buffers
+	void flush();
+	unsigned int getDrawCallCount(); // draw calls made during the last frame
+	unsigned int getGLCallCount(); // GL calls made by the renderer during the last frame, filtered state changes don't count
+	void endFrame(); // called by swapBuffers()
+
+	// GL state, only changes reach GL. Everything has to go through these (instead of calling GL directly), or they'd skip calls that are needed.
+	void setEnabled(GLenum capability, bool enabled);
+	void bindTexture(GLuint texture);
+	void deleteTexture(GLuint texture); // flushes first, queued up draws might still use it
+	void setBlendFunc(GLenum sfactor, GLenum dfactor);
+	void setScissor(const Eigen::Vector4i& box);
+	void resetState(); // a new context starts with GL's defaults, called by init()
+	void countGLCalls(unsigned int count); // for GL calls made without the functions above
+
+	// Offscreen render targets: a framebuffer object drawing into a screen sized RGBA texture, see GuiComponent::setRenderCached().
+	// The texture comes out the same way up as the ones made from images.
+	bool hasRenderTargets(); // needs framebuffer objects (core in GLES 2.0 and OpenGL 3.0, an extension before that)
+	bool createRenderTarget(GLuint* framebuffer, GLuint* texture);
+	void deleteRenderTarget(GLuint framebuffer, GLuint texture);
+	// Draws go into framebuffer until the matching popRenderTarget(), then back into whatever was bound before (targets can nest).
+	// Both flush first. A target starts out without clip rects, the previous one gets its own back.
+	void pushRenderTarget(GLuint framebuffer);
+	void popRenderTarget();
+	void clear(); // clears what's bound (within the clip rect) to the same colour the screen starts each frame with
+
+	// GPU time of whole frames (from one endFrame() to the next), with timer queries: ARB_timer_query on desktop GL, EXT_disjoint_timer_query on GLES 2.0.
+	// Results are read a few frames late so we never wait for the GPU. Queries can't be nested, so there's nothing finer than a frame.
+	bool hasGPUTimer();
+	void setGPUTimerEnabled(bool enabled);
+	float getGPUFrameTime(); // in ms, negative while there's no result
+
+	// Copies verts into the stream buffer (a VBO, or just client memory without VBO support) and points the vertex, texture coordinate and color arrays at them.
+	// Both stay bound/enabled, every draw binds its vertices first anyway.
+	void bindVertices(const Vertex* verts, unsigned int count);
+	void deinitVertexBuffer(); // the buffer belongs to the GL context, called by deinit()
+
+	// The GL pipeline: Renderer_fixed_gl.cpp (fixed function) or Renderer_shaders_gl.cpp (GLES 2.0 / OpenGL 2.1 shaders),
+	// depending on the GLSystem CMake option.
+	bool initPipeline(); // called by init() once there's a context
+	void deinitPipeline(); // called by deinit()
+	bool hasShader(Shader shader); // SHADER_SDF needs shader support, the others always work
+	void setVertexPointers(const GLubyte* base); // points the vertex attributes at the Vertex array starting at base (in the bound VBO or client memory)
+	void setDrawState(GLuint texture, Shader shader, const Eigen::Affine3f& transform); // for the next glDrawArrays, the texture is already bound
 
 	void drawRect(int x, int y, int w, int h, unsigned int color, GLenum blend_sfactor = GL_SRC_ALPHA, GLenum blend_dfactor = GL_ONE_MINUS_SRC_ALPHA);
 	void drawRect(float x, float y, float w, float h, unsigned int color, GLenum blend_sfactor = GL_SRC_ALPHA, GLenum blend_dfactor = GL_ONE_MINUS_SRC_ALPHA);
@@ -6,10 +6,239 @@
 #include <boost/filesystem.hpp>
 #include "Log.h"
 #include <stack>
+#include <map>
 #include "Util.h"
+#include <SDL.h>
+#include <float.h>
+
+#define MAX_BATCH_LOOKBACK 16 // how many batches back a draw looks for one it can join
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifdef USE_OPENGL_ES
+	// OpenGL ES 1.1 and 2.0 always have buffer objects
+	#define genBuffers glGenBuffers
+	#define deleteBuffers glDeleteBuffers
+	#define bindBuffer glBindBuffer
+	#define bufferData glBufferData
+#else
+	typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint* buffers);
+	typedef void (APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint* buffers);
+	typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+	typedef void (APIENTRY *BufferDataProc)(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage);
+
+	static GenBuffersProc genBuffers = NULL;
+	static DeleteBuffersProc deleteBuffers = NULL;
+	static BindBufferProc bindBuffer = NULL;
+	static BufferDataProc bufferData = NULL;
+#endif
+
+#ifndef GL_FRAMEBUFFER
+// same values for the EXT and OES versions
+#define GL_FRAMEBUFFER 0x8D40
+#define GL_COLOR_ATTACHMENT0 0x8CE0
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+
+#if defined(USE_OPENGL_ES) && defined(USE_OPENGL_SHADERS)
+	// core in OpenGL ES 2.0
+	#define genFramebuffers glGenFramebuffers
+	#define deleteFramebuffers glDeleteFramebuffers
+	#define bindFramebuffer glBindFramebuffer
+	#define framebufferTexture2D glFramebufferTexture2D
+	#define checkFramebufferStatus glCheckFramebufferStatus
+#else
+	typedef void (APIENTRY *GenFramebuffersProc)(GLsizei n, GLuint* framebuffers);
+	typedef void (APIENTRY *DeleteFramebuffersProc)(GLsizei n, const GLuint* framebuffers);
+	typedef void (APIENTRY *BindFramebufferProc)(GLenum target, GLuint framebuffer);
+	typedef void (APIENTRY *FramebufferTexture2DProc)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+	typedef GLenum (APIENTRY *CheckFramebufferStatusProc)(GLenum target);
+
+	static GenFramebuffersProc genFramebuffers = NULL;
+	static DeleteFramebuffersProc deleteFramebuffers = NULL;
+	static BindFramebufferProc bindFramebuffer = NULL;
+	static FramebufferTexture2DProc framebufferTexture2D = NULL;
+	static CheckFramebufferStatusProc checkFramebufferStatus = NULL;
+#endif
+
+#ifndef GL_TIME_ELAPSED
+// same values for the EXT version
+#define GL_TIME_ELAPSED 0x88BF
+#define GL_QUERY_RESULT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+typedef void (APIENTRY *GenQueriesProc)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY *DeleteQueriesProc)(GLsizei n, const GLuint* ids);
+typedef void (APIENTRY *BeginQueryProc)(GLenum target, GLuint id);
+typedef void (APIENTRY *EndQueryProc)(GLenum target);
+typedef void (APIENTRY *GetQueryObjectuivProc)(GLuint id, GLenum pname, GLuint* params);
+typedef void (APIENTRY *GetQueryObjectui64vProc)(GLuint id, GLenum pname, unsigned long long* params);
+
+static GenQueriesProc genQueries = NULL;
+static DeleteQueriesProc deleteQueries = NULL;
+static BeginQueryProc beginQuery = NULL;
+static EndQueryProc endQuery = NULL;
+static GetQueryObjectuivProc getQueryObjectuiv = NULL;
+static GetQueryObjectui64vProc getQueryObjectui64v = NULL;
+
+#define GPU_TIMER_QUERIES 4 // frames in flight before we'd have to wait for a result
 
 namespace Renderer {
 	std::stack<Eigen::Vector4i> clipStack;
+	Eigen::Affine3f currentMatrix = Eigen::Affine3f::Identity();
+
+	GLuint vertexBuffer = 0;
+	bool vertexBufferChecked = false; // tried to create vertexBuffer, it stays 0 without VBO support
+
+	bool framebuffersChecked = false;
+	bool framebuffersLoaded = false;
+
+	// the targets below the bound one (the screen first), each with the clip rects it had
+	struct BoundTarget
+	{
+		GLuint framebuffer;
+		std::stack<Eigen::Vector4i> clipStack;
+	};
+	std::vector<BoundTarget> targetStack;
+
+	bool gpuTimerChecked = false;
+	bool gpuTimerLoaded = false;
+	bool gpuTimerEnabled = false;
+	GLuint gpuTimerQueries[GPU_TIMER_QUERIES] = { 0 }; // used round robin
+	unsigned int gpuTimerFirst = 0; // the oldest query waiting for its result
+	unsigned int gpuTimerPending = 0; // ended queries waiting for their result
+	bool gpuTimerRunning = false; // the query after the pending ones has begun
+	float gpuFrameTime = -1;
+
+	// draws with the same state, in screen space
+	struct Batch
+	{
+		GLuint texture;
+		GLenum blendSrc;
+		GLenum blendDst;
+		Shader shader;
+		Eigen::Vector4f bounds; // min x, min y, max x, max y
+		std::vector<Vertex> verts;
+	};
+
+	std::vector<Batch> batches; // the ones past batchCount are unused, kept so their memory is reused
+	unsigned int batchCount = 0;
+	std::vector<Vertex> transformed; // the draw being added
+	std::vector<Vertex> flushed; // all batches, for a single upload
+
+	unsigned int drawCalls = 0;
+	unsigned int lastFrameDrawCalls = 0;
+	unsigned int glCalls = 0;
+	unsigned int lastFrameGLCalls = 0;
+
+	// what GL has been told last, starts out as GL's defaults
+	struct State
+	{
+		State() : framebuffer(0), texture(0), blendSrc(GL_ONE), blendDst(GL_ZERO), scissor(-1, -1, -1, -1) {}
+
+		std::map<GLenum, bool> enabled; // missing ones are disabled
+		GLuint framebuffer;
+		GLuint texture;
+		GLenum blendSrc;
+		GLenum blendDst;
+		Eigen::Vector4i scissor; // the initial scissor box is the window's size, which we don't know yet
+	} state;
+
+	static bool loadBufferFunctions()
+	{
+#ifdef USE_OPENGL_ES
+		return true;
+#else
+		// core since OpenGL 1.5
+		int major = 0, minor = 0;
+		const char* version = (const char*)glGetString(GL_VERSION);
+		if(!version || sscanf(version, "%d.%d", &major, &minor) != 2 || major * 10 + minor < 15)
+			return false;
+
+		genBuffers = (GenBuffersProc)SDL_GL_GetProcAddress("glGenBuffers");
+		deleteBuffers = (DeleteBuffersProc)SDL_GL_GetProcAddress("glDeleteBuffers");
+		bindBuffer = (BindBufferProc)SDL_GL_GetProcAddress("glBindBuffer");
+		bufferData = (BufferDataProc)SDL_GL_GetProcAddress("glBufferData");
+
+		return genBuffers && deleteBuffers && bindBuffer && bufferData;
+#endif
+	}
+
+	static bool loadFramebufferFunctions()
+	{
+#if defined(USE_OPENGL_ES) && defined(USE_OPENGL_SHADERS)
+		return true;
+#else
+	#ifdef USE_OPENGL_ES
+		if(!SDL_GL_ExtensionSupported("GL_OES_framebuffer_object"))
+			return false;
+		const std::string suffix = "OES";
+	#else
+		// core since OpenGL 3.0 (ARB_framebuffer_object), the older EXT version has the same functions with a suffix
+		std::string suffix;
+		if(!SDL_GL_ExtensionSupported("GL_ARB_framebuffer_object"))
+		{
+			if(!SDL_GL_ExtensionSupported("GL_EXT_framebuffer_object"))
+				return false;
+			suffix = "EXT";
+		}
+	#endif
+
+		genFramebuffers = (GenFramebuffersProc)SDL_GL_GetProcAddress(("glGenFramebuffers" + suffix).c_str());
+		deleteFramebuffers = (DeleteFramebuffersProc)SDL_GL_GetProcAddress(("glDeleteFramebuffers" + suffix).c_str());
+		bindFramebuffer = (BindFramebufferProc)SDL_GL_GetProcAddress(("glBindFramebuffer" + suffix).c_str());
+		framebufferTexture2D = (FramebufferTexture2DProc)SDL_GL_GetProcAddress(("glFramebufferTexture2D" + suffix).c_str());
+		checkFramebufferStatus = (CheckFramebufferStatusProc)SDL_GL_GetProcAddress(("glCheckFramebufferStatus" + suffix).c_str());
+
+		return genFramebuffers && deleteFramebuffers && bindFramebuffer && framebufferTexture2D && checkFramebufferStatus;
+#endif
+	}
+
+	static bool loadTimerQueryFunctions()
+	{
+#if defined(USE_OPENGL_ES) && !defined(USE_OPENGL_SHADERS)
+		return false;
+#else
+	#ifdef USE_OPENGL_ES
+		if(!SDL_GL_ExtensionSupported("GL_EXT_disjoint_timer_query"))
+			return false;
+		const std::string suffix = "EXT";
+	#else
+		// core since OpenGL 3.3, the query object functions themselves since 1.5
+		if(!SDL_GL_ExtensionSupported("GL_ARB_timer_query"))
+			return false;
+		const std::string suffix;
+	#endif
+
+		genQueries = (GenQueriesProc)SDL_GL_GetProcAddress(("glGenQueries" + suffix).c_str());
+		deleteQueries = (DeleteQueriesProc)SDL_GL_GetProcAddress(("glDeleteQueries" + suffix).c_str());
+		beginQuery = (BeginQueryProc)SDL_GL_GetProcAddress(("glBeginQuery" + suffix).c_str());
+		endQuery = (EndQueryProc)SDL_GL_GetProcAddress(("glEndQuery" + suffix).c_str());
+		getQueryObjectuiv = (GetQueryObjectuivProc)SDL_GL_GetProcAddress(("glGetQueryObjectuiv" + suffix).c_str());
+		getQueryObjectui64v = (GetQueryObjectui64vProc)SDL_GL_GetProcAddress(("glGetQueryObjectui64v" + suffix).c_str());
+
+		return genQueries && deleteQueries && beginQuery && endQuery && getQueryObjectuiv && getQueryObjectui64v;
+#endif
+	}
+
+	// only the GLES extension reports disjoint events (e.g. the GPU changing its clock), results spanning one are garbage
+	static bool gpuTimerDisjoint()
+	{
+#ifdef USE_OPENGL_ES
+		GLint disjoint = 0;
+		glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+		glCalls++;
+		return disjoint != 0;
+#else
+		return false;
+#endif
+	}
 
 	void setColor4bArray(GLubyte* array, unsigned int color)
 	{
@@ -19,13 +248,293 @@ namespace Renderer {
 		array[3] = (color & 0x000000ff);
 	}
 
-	void buildGLColorArray(GLubyte* ptr, unsigned int color, unsigned int vertCount)
+	void buildVertexColors(Vertex* verts, unsigned int color, unsigned int vertCount)
 	{
-		unsigned int colorGl;
-		setColor4bArray((GLubyte*)&colorGl, color);
+		GLubyte colorGl[4];
+		setColor4bArray(colorGl, color);
 		for(unsigned int i = 0; i < vertCount; i++)
+			memcpy(verts[i].color, colorGl, 4);
+	}
+
+	void setEnabled(GLenum capability, bool enabled)
+	{
+		bool& current = state.enabled[capability];
+		if(current == enabled)
+			return;
+
+		if(enabled)
+			glEnable(capability);
+		else
+			glDisable(capability);
+
+		current = enabled;
+		glCalls++;
+	}
+
+	void bindTexture(GLuint texture)
+	{
+		if(state.texture == texture)
+			return;
+
+		glBindTexture(GL_TEXTURE_2D, texture);
+		state.texture = texture;
+		glCalls++;
+	}
+
+	void deleteTexture(GLuint texture)
+	{
+		flush();
+
+		glDeleteTextures(1, &texture);
+		glCalls++;
+
+		// GL unbinds it, and might hand out the same name again
+		if(state.texture == texture)
+			state.texture = 0;
+	}
+
+	void setBlendFunc(GLenum sfactor, GLenum dfactor)
+	{
+		if(state.blendSrc == sfactor && state.blendDst == dfactor)
+			return;
+
+		glBlendFunc(sfactor, dfactor);
+		state.blendSrc = sfactor;
+		state.blendDst = dfactor;
+		glCalls++;
+	}
+
+	void setScissor(const Eigen::Vector4i& box)
+	{
+		if(state.scissor == box)
+			return;
+
+		glScissor(box[0], box[1], box[2], box[3]);
+		state.scissor = box;
+		glCalls++;
+	}
+
+	static void resetGPUTimer()
+	{
+		memset(gpuTimerQueries, 0, sizeof(gpuTimerQueries));
+		gpuTimerFirst = 0;
+		gpuTimerPending = 0;
+		gpuTimerRunning = false;
+		gpuFrameTime = -1;
+	}
+
+	void resetState()
+	{
+		state = State();
+		targetStack.clear();
+		resetGPUTimer(); // the queries belonged to the old context
+	}
+
+	bool hasRenderTargets()
+	{
+		if(!framebuffersChecked)
+		{
+			framebuffersChecked = true;
+			framebuffersLoaded = loadFramebufferFunctions();
+			if(!framebuffersLoaded)
+				LOG(LogWarning) << "No framebuffer object support, render caching is disabled";
+		}
+
+		return framebuffersLoaded;
+	}
+
+	bool createRenderTarget(GLuint* framebuffer, GLuint* texture)
+	{
+		*framebuffer = 0;
+		*texture = 0;
+		if(!hasRenderTargets())
+			return false;
+
+		glGenTextures(1, texture);
+		bindTexture(*texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, getScreenWidth(), getScreenHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		// queued up draws go to whatever is bound when they're flushed, so this doesn't need a flush
+		genFramebuffers(1, framebuffer);
+		bindFramebuffer(GL_FRAMEBUFFER, *framebuffer);
+		framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *texture, 0);
+		const bool complete = checkFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		bindFramebuffer(GL_FRAMEBUFFER, state.framebuffer);
+		glCalls += 11;
+
+		if(!complete)
+		{
+			LOG(LogError) << "Render target framebuffer is incomplete!";
+			deleteRenderTarget(*framebuffer, *texture);
+			*framebuffer = 0;
+			*texture = 0;
+			return false;
+		}
+
+		return true;
+	}
+
+	void deleteRenderTarget(GLuint framebuffer, GLuint texture)
+	{
+		if(framebuffer != 0)
+		{
+			// shouldn't happen, but don't leave a deleted framebuffer bound
+			while(state.framebuffer == framebuffer && !targetStack.empty())
+				popRenderTarget();
+
+			deleteFramebuffers(1, &framebuffer);
+			glCalls++;
+		}
+
+		if(texture != 0)
+			deleteTexture(texture);
+	}
+
+	static void bindTargetFramebuffer(GLuint framebuffer)
+	{
+		// the clip rects were just swapped
+		if(!clipStack.empty())
+			setScissor(clipStack.top());
+		setEnabled(GL_SCISSOR_TEST, !clipStack.empty());
+
+		if(state.framebuffer != framebuffer)
+		{
+			bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			state.framebuffer = framebuffer;
+			glCalls++;
+		}
+	}
+
+	void pushRenderTarget(GLuint framebuffer)
+	{
+		flush();
+
+		// render targets start out unclipped, whatever was bound before gets its clip rects back with popRenderTarget()
+		BoundTarget previous;
+		previous.framebuffer = state.framebuffer;
+		targetStack.push_back(previous);
+		std::swap(clipStack, targetStack.back().clipStack);
+
+		bindTargetFramebuffer(framebuffer);
+	}
+
+	void popRenderTarget()
+	{
+		if(targetStack.empty())
 		{
-			((GLuint*)ptr)[i] = colorGl;
+			LOG(LogError) << "Tried to popRenderTarget while the stack was empty!";
+			return;
+		}
+
+		flush();
+
+		std::swap(clipStack, targetStack.back().clipStack);
+		const GLuint framebuffer = targetStack.back().framebuffer;
+		targetStack.pop_back();
+
+		bindTargetFramebuffer(framebuffer);
+	}
+
+	void clear()
+	{
+		// queued draws have to land first
+		flush();
+
+		glClear(GL_COLOR_BUFFER_BIT);
+		glCalls++;
+	}
+
+	void countGLCalls(unsigned int count)
+	{
+		glCalls += count;
+	}
+
+	bool hasGPUTimer()
+	{
+		if(!gpuTimerChecked)
+		{
+			gpuTimerChecked = true;
+			gpuTimerLoaded = loadTimerQueryFunctions();
+			if(!gpuTimerLoaded)
+				LOG(LogWarning) << "No timer query support, GPU frame times can't be measured";
+		}
+
+		return gpuTimerLoaded;
+	}
+
+	void setGPUTimerEnabled(bool enabled)
+	{
+		if(gpuTimerEnabled == enabled)
+			return;
+
+		gpuTimerEnabled = enabled;
+		if(!enabled && gpuTimerQueries[0] != 0)
+		{
+			if(gpuTimerRunning)
+				endQuery(GL_TIME_ELAPSED);
+
+			deleteQueries(GPU_TIMER_QUERIES, gpuTimerQueries);
+			glCalls += gpuTimerRunning ? 2 : 1;
+			resetGPUTimer();
+		}
+	}
+
+	float getGPUFrameTime()
+	{
+		return gpuFrameTime;
+	}
+
+	// ends the last frame's query and begins the next one's, called by endFrame()
+	static void updateGPUTimer()
+	{
+		if(!gpuTimerEnabled || !hasGPUTimer())
+			return;
+
+		if(gpuTimerQueries[0] == 0)
+		{
+			genQueries(GPU_TIMER_QUERIES, gpuTimerQueries);
+			glCalls++;
+		}
+
+		if(gpuTimerRunning)
+		{
+			endQuery(GL_TIME_ELAPSED);
+			gpuTimerRunning = false;
+			gpuTimerPending++;
+			glCalls++;
+		}
+
+		// take the results that are in, oldest first
+		const bool disjoint = gpuTimerDisjoint();
+		while(gpuTimerPending > 0)
+		{
+			const GLuint query = gpuTimerQueries[gpuTimerFirst];
+			GLuint available = 0;
+			getQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+			glCalls++;
+			if(!available)
+				break;
+
+			unsigned long long elapsed = 0; // ns
+			getQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+			glCalls++;
+			if(!disjoint)
+				gpuFrameTime = elapsed / 1000000.0f;
+
+			gpuTimerFirst = (gpuTimerFirst + 1) % GPU_TIMER_QUERIES;
+			gpuTimerPending--;
+		}
+
+		// with every query still pending this frame goes unmeasured
+		if(gpuTimerPending < GPU_TIMER_QUERIES)
+		{
+			beginQuery(GL_TIME_ELAPSED, gpuTimerQueries[(gpuTimerFirst + gpuTimerPending) % GPU_TIMER_QUERIES]);
+			gpuTimerRunning = true;
+			glCalls++;
 		}
 	}
 
@@ -62,9 +571,24 @@ namespace Renderer {
 		if(box[3] < 0)
 			box[3] = 0;
 
+		// the same clip as before (e.g. nested lists) doesn't change what the queued up draws look like
+		if(clipStack.empty() || clipStack.top() != box)
+			flush();
+
 		clipStack.push(box);
-		glScissor(box[0], box[1], box[2], box[3]);
-		glEnable(GL_SCISSOR_TEST);
+		setScissor(box);
+		setEnabled(GL_SCISSOR_TEST, true);
+	}
+
+	Eigen::Vector4f getClipBounds()
+	{
+		if(clipStack.empty())
+			return Eigen::Vector4f(0, 0, (float)getScreenWidth(), (float)getScreenHeight());
+
+		// the stack is in glScissor's space, y+ = up
+		const Eigen::Vector4i& box = clipStack.top();
+		const float top = (float)getScreenHeight() - box[1] - box[3];
+		return Eigen::Vector4f((float)box[0], top, (float)(box[0] + box[2]), top + box[3]);
 	}
 
 	void popClipRect()
@@ -75,13 +599,16 @@ namespace Renderer {
 			return;
 		}
 
+		const Eigen::Vector4i box = clipStack.top();
 		clipStack.pop();
 		if(clipStack.empty())
 		{
-			glDisable(GL_SCISSOR_TEST);
-		}else{
-			Eigen::Vector4i top = clipStack.top();
-			glScissor(top[0], top[1], top[2], top[3]);
+			flush();
+			setEnabled(GL_SCISSOR_TEST, false);
+		}else if(clipStack.top() != box)
+		{
+			flush();
+			setScissor(clipStack.top());
 		}
 	}
 
@@ -92,49 +619,204 @@ namespace Renderer {
 
 	void drawRect(int x, int y, int w, int h, unsigned int color, GLenum blend_sfactor, GLenum blend_dfactor)
 	{
-#ifdef USE_OPENGL_ES
-		GLshort points[12];
-#else
-		GLint points[12];
-#endif
+		Vertex verts[6];
 
-		points[0] = x; points [1] = y;
-		points[2] = x; points[3] = y + h;
-		points[4] = x + w; points[5] = y;
+		verts[0].pos << (float)x, (float)y;
+		verts[1].pos << (float)x, (float)(y + h);
+		verts[2].pos << (float)(x + w), (float)y;
 
-		points[6] = x + w; points[7] = y;
-		points[8] = x; points[9] = y + h;
-		points[10] = x + w; points[11] = y + h;
+		verts[3].pos << (float)(x + w), (float)y;
+		verts[4].pos << (float)x, (float)(y + h);
+		verts[5].pos << (float)(x + w), (float)(y + h);
 
-		GLubyte colors[6*4];
-		buildGLColorArray(colors, color, 6);
+		for(int i = 0; i < 6; i++)
+			verts[i].tex << 0.0f, 0.0f;
 
-		glEnable(GL_BLEND);
-		glBlendFunc(blend_sfactor, blend_dfactor);
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_COLOR_ARRAY);
-
-#ifdef USE_OPENGL_ES
-		glVertexPointer(2, GL_SHORT, 0, points);
-#else
-		glVertexPointer(2, GL_INT, 0, points);
-#endif
-		glColorPointer(4, GL_UNSIGNED_BYTE, 0, colors);
-
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-
-		glDisable(GL_BLEND);
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glDisableClientState(GL_COLOR_ARRAY);
+		buildVertexColors(verts, color, 6);
+		drawTriangles(verts, 6, 0, blend_sfactor, blend_dfactor);
 	}
 
 	void setMatrix(float* matrix)
 	{
-		glLoadMatrixf(matrix);
+		// only remembered, flush() and drawLines() hand it to the pipeline
+		currentMatrix.matrix() = Eigen::Map<Eigen::Matrix4f>(matrix);
 	}
 
 	void setMatrix(const Eigen::Affine3f& matrix)
 	{
 		setMatrix((float*)matrix.data());
 	}
+
+	const Eigen::Affine3f& getMatrix()
+	{
+		return currentMatrix;
+	}
+
+	void bindVertices(const Vertex* verts, unsigned int count)
+	{
+		if(!vertexBufferChecked)
+		{
+			vertexBufferChecked = true;
+			if(loadBufferFunctions())
+			{
+				// nothing else uses GL_ARRAY_BUFFER, it stays bound
+				genBuffers(1, &vertexBuffer);
+				bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+			}else{
+				LOG(LogWarning) << "No vertex buffer object support, drawing from client memory";
+			}
+		}
+
+		const GLubyte* base = (const GLubyte*)verts;
+		if(vertexBuffer != 0)
+		{
+			// replacing the whole buffer lets the driver hand out fresh memory instead of waiting for the last draw using it
+			bufferData(GL_ARRAY_BUFFER, count * sizeof(Vertex), verts, GL_DYNAMIC_DRAW);
+			base = NULL;
+			glCalls++;
+		}
+
+		setVertexPointers(base);
+	}
+
+	void deinitVertexBuffer()
+	{
+		if(vertexBuffer != 0)
+			deleteBuffers(1, &vertexBuffer);
+
+		vertexBuffer = 0;
+		vertexBufferChecked = false;
+	}
+
+	static bool overlaps(const Eigen::Vector4f& a, const Eigen::Vector4f& b)
+	{
+		return a[0] < b[2] && b[0] < a[2] && a[1] < b[3] && b[1] < a[3];
+	}
+
+	void drawTriangles(const Vertex* verts, unsigned int count, GLuint texture, GLenum blend_sfactor, GLenum blend_dfactor, Shader shader)
+	{
+		if(count == 0)
+			return;
+
+		// to screen space, so draws with different matrices can share a batch
+		const Eigen::Matrix2f linear = currentMatrix.linear().topLeftCorner<2, 2>();
+		const Eigen::Vector2f translation = currentMatrix.translation().head<2>();
+
+		Eigen::Vector4f bounds(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+		transformed.resize(count);
+		for(unsigned int i = 0; i < count; i++)
+		{
+			transformed[i] = verts[i];
+			transformed[i].pos = linear * verts[i].pos + translation;
+
+			bounds[0] = std::min(bounds[0], transformed[i].pos.x());
+			bounds[1] = std::min(bounds[1], transformed[i].pos.y());
+			bounds[2] = std::max(bounds[2], transformed[i].pos.x());
+			bounds[3] = std::max(bounds[3], transformed[i].pos.y());
+		}
+
+		// join the latest batch with the same state, unless something drawn after it overlaps us (we'd end up below it)
+		Batch* batch = NULL;
+		for(unsigned int i = batchCount; i > 0 && batchCount - i < MAX_BATCH_LOOKBACK; i--)
+		{
+			Batch& candidate = batches[i - 1];
+			if(candidate.texture == texture && candidate.blendSrc == blend_sfactor && candidate.blendDst == blend_dfactor && candidate.shader == shader)
+			{
+				batch = &candidate;
+				break;
+			}
+
+			if(overlaps(candidate.bounds, bounds))
+				break;
+		}
+
+		if(batch == NULL)
+		{
+			if(batchCount == batches.size())
+				batches.push_back(Batch());
+
+			batch = &batches[batchCount++];
+			batch->texture = texture;
+			batch->blendSrc = blend_sfactor;
+			batch->blendDst = blend_dfactor;
+			batch->shader = shader;
+			batch->bounds = bounds;
+			batch->verts.clear();
+		}else{
+			batch->bounds << std::min(batch->bounds[0], bounds[0]), std::min(batch->bounds[1], bounds[1]),
+				std::max(batch->bounds[2], bounds[2]), std::max(batch->bounds[3], bounds[3]);
+		}
+
+		batch->verts.insert(batch->verts.end(), transformed.begin(), transformed.end());
+	}
+
+	void drawLines(const Vertex* verts, unsigned int count)
+	{
+		flush();
+
+		setEnabled(GL_BLEND, true);
+		setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		bindVertices(verts, count);
+		setDrawState(0, SHADER_DEFAULT, currentMatrix);
+		glDrawArrays(GL_LINES, 0, count);
+		drawCalls++;
+		glCalls++;
+	}
+
+	void flush()
+	{
+		if(batchCount == 0)
+			return;
+
+		// one upload for everything
+		flushed.clear();
+		for(unsigned int i = 0; i < batchCount; i++)
+			flushed.insert(flushed.end(), batches[i].verts.begin(), batches[i].verts.end());
+
+		bindVertices(flushed.data(), flushed.size());
+		setEnabled(GL_BLEND, true); // everything we draw is blended, it stays on
+
+		// the vertices are in screen space already
+		const Eigen::Affine3f identity = Eigen::Affine3f::Identity();
+
+		unsigned int first = 0;
+		for(unsigned int i = 0; i < batchCount; i++)
+		{
+			const Batch& batch = batches[i];
+
+			if(batch.texture != 0)
+				bindTexture(batch.texture);
+
+			setDrawState(batch.texture, batch.shader, identity);
+			setBlendFunc(batch.blendSrc, batch.blendDst);
+
+			glDrawArrays(GL_TRIANGLES, first, batch.verts.size());
+			drawCalls++;
+			glCalls++;
+			first += batch.verts.size();
+		}
+
+		batchCount = 0;
+	}
+
+	unsigned int getDrawCallCount()
+	{
+		return lastFrameDrawCalls;
+	}
+
+	unsigned int getGLCallCount()
+	{
+		return lastFrameGLCalls;
+	}
+
+	void endFrame()
+	{
+		lastFrameDrawCalls = drawCalls;
+		drawCalls = 0;
+		lastFrameGLCalls = glCalls;
+		glCalls = 0;
+
+		updateGPUTimer();
+	}
 };
@@ -0,0 +1,238 @@
+#include "Renderer.h"
+#include "platform.h"
+#include GLHEADER
+#include "Log.h"
+#include <SDL.h>
+#include <stdlib.h>
+
+#ifdef USE_OPENGL_ES
+	#define glOrtho glOrthof
+#endif
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#define GL_VERTEX_SHADER 0x8B31
+#define GL_COMPILE_STATUS 0x8B81
+#define GL_LINK_STATUS 0x8B82
+#endif
+
+// SDF glyphs need a (tiny) shader to turn distances back into antialiased edges.
+// That means desktop GL 2.0, GLES 1.x has no shaders and always uses bitmap glyphs.
+// It only replaces the fragment stage, everything else still comes from the fixed function state.
+namespace SDFShader
+{
+	typedef GLuint (APIENTRY *CreateShaderProc)(GLenum type);
+	typedef void (APIENTRY *ShaderSourceProc)(GLuint shader, GLsizei count, const char* const* string, const GLint* length);
+	typedef void (APIENTRY *CompileShaderProc)(GLuint shader);
+	typedef void (APIENTRY *GetShaderivProc)(GLuint shader, GLenum pname, GLint* params);
+	typedef void (APIENTRY *DeleteShaderProc)(GLuint shader);
+	typedef GLuint (APIENTRY *CreateProgramProc)();
+	typedef void (APIENTRY *AttachShaderProc)(GLuint program, GLuint shader);
+	typedef void (APIENTRY *LinkProgramProc)(GLuint program);
+	typedef void (APIENTRY *GetProgramivProc)(GLuint program, GLenum pname, GLint* params);
+	typedef void (APIENTRY *UseProgramProc)(GLuint program);
+	typedef void (APIENTRY *DeleteProgramProc)(GLuint program);
+
+	static CreateShaderProc createShader = NULL;
+	static ShaderSourceProc shaderSource = NULL;
+	static CompileShaderProc compileShader = NULL;
+	static GetShaderivProc getShaderiv = NULL;
+	static DeleteShaderProc deleteShader = NULL;
+	static CreateProgramProc createProgram = NULL;
+	static AttachShaderProc attachShader = NULL;
+	static LinkProgramProc linkProgram = NULL;
+	static GetProgramivProc getProgramiv = NULL;
+	static UseProgramProc useProgram = NULL;
+	static DeleteProgramProc deleteProgram = NULL;
+
+	static GLuint program = 0;
+	static bool broken = false; // compiling failed once, don't try again
+
+	static const char* vertexSource =
+		"#version 110\n"
+		"void main()\n"
+		"{\n"
+		"	gl_Position = ftransform();\n"
+		"	gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+		"	gl_FrontColor = gl_Color;\n"
+		"}\n";
+
+	static const char* fragmentSource =
+		"#version 110\n"
+		"uniform sampler2D tex;\n"
+		"void main()\n"
+		"{\n"
+		"	float distance = texture2D(tex, gl_TexCoord[0].xy).a;\n"
+		"	float width = fwidth(distance) * 0.75;\n"
+		"	float alpha = smoothstep(0.5 - width, 0.5 + width, distance);\n"
+		"	gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * alpha);\n"
+		"}\n";
+
+	static bool loadFunctions()
+	{
+#ifdef USE_OPENGL_ES
+		return false;
+#else
+		const char* version = (const char*)glGetString(GL_VERSION);
+		if(!version || atoi(version) < 2)
+			return false;
+
+		createShader = (CreateShaderProc)SDL_GL_GetProcAddress("glCreateShader");
+		shaderSource = (ShaderSourceProc)SDL_GL_GetProcAddress("glShaderSource");
+		compileShader = (CompileShaderProc)SDL_GL_GetProcAddress("glCompileShader");
+		getShaderiv = (GetShaderivProc)SDL_GL_GetProcAddress("glGetShaderiv");
+		deleteShader = (DeleteShaderProc)SDL_GL_GetProcAddress("glDeleteShader");
+		createProgram = (CreateProgramProc)SDL_GL_GetProcAddress("glCreateProgram");
+		attachShader = (AttachShaderProc)SDL_GL_GetProcAddress("glAttachShader");
+		linkProgram = (LinkProgramProc)SDL_GL_GetProcAddress("glLinkProgram");
+		getProgramiv = (GetProgramivProc)SDL_GL_GetProcAddress("glGetProgramiv");
+		useProgram = (UseProgramProc)SDL_GL_GetProcAddress("glUseProgram");
+		deleteProgram = (DeleteProgramProc)SDL_GL_GetProcAddress("glDeleteProgram");
+
+		return createShader && shaderSource && compileShader && getShaderiv && deleteShader && createProgram &&
+			attachShader && linkProgram && getProgramiv && useProgram && deleteProgram;
+#endif
+	}
+
+	static GLuint compile(GLenum type, const char* source)
+	{
+		GLuint shader = createShader(type);
+		shaderSource(shader, 1, &source, NULL);
+		compileShader(shader);
+
+		GLint ok = 0;
+		getShaderiv(shader, GL_COMPILE_STATUS, &ok);
+		if(!ok)
+		{
+			deleteShader(shader);
+			return 0;
+		}
+
+		return shader;
+	}
+
+	// compiles the program if needed, returns false if SDF glyphs can't be drawn
+	static bool load()
+	{
+		if(program != 0)
+			return true;
+		if(broken || !loadFunctions())
+			return false;
+
+		GLuint vertexShader = compile(GL_VERTEX_SHADER, vertexSource);
+		GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, fragmentSource);
+		if(vertexShader && fragmentShader)
+		{
+			program = createProgram();
+			attachShader(program, vertexShader);
+			attachShader(program, fragmentShader);
+			linkProgram(program);
+
+			GLint ok = 0;
+			getProgramiv(program, GL_LINK_STATUS, &ok);
+			if(!ok)
+			{
+				deleteProgram(program);
+				program = 0;
+			}
+		}
+
+		if(vertexShader)
+			deleteShader(vertexShader);
+		if(fragmentShader)
+			deleteShader(fragmentShader);
+
+		if(program == 0)
+		{
+			LOG(LogError) << "Could not compile the SDF font shader, using bitmap fonts instead";
+			broken = true;
+			return false;
+		}
+
+		return true;
+	}
+
+	static void unload()
+	{
+		if(program != 0)
+		{
+			deleteProgram(program);
+			program = 0;
+		}
+	}
+}
+
+namespace Renderer
+{
+	GLuint currentProgram = 0;
+	bool arraysEnabled = false;
+	bool hasModelview = false; // modelview has been loaded since the pipeline was set up
+	Eigen::Affine3f modelview;
+
+	bool initPipeline()
+	{
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+		glOrtho(0, getScreenWidth(), getScreenHeight(), 0, -1.0, 1.0);
+		glMatrixMode(GL_MODELVIEW);
+
+		return true;
+	}
+
+	void deinitPipeline()
+	{
+		currentProgram = 0;
+		arraysEnabled = false;
+		hasModelview = false;
+		SDFShader::unload(); // compiled again the next time an SDF glyph is drawn
+	}
+
+	bool hasShader(Shader shader)
+	{
+		return shader != SHADER_SDF || SDFShader::load();
+	}
+
+	void setVertexPointers(const GLubyte* base)
+	{
+		// every draw comes from a Vertex array, so they never need to be disabled again
+		if(!arraysEnabled)
+		{
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+			glEnableClientState(GL_COLOR_ARRAY);
+			arraysEnabled = true;
+			countGLCalls(3);
+		}
+
+		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), base);
+		glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), base + sizeof(Eigen::Vector2f));
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), base + sizeof(Eigen::Vector2f) * 2);
+		countGLCalls(3);
+	}
+
+	void setDrawState(GLuint texture, Shader shader, const Eigen::Affine3f& transform)
+	{
+		// GL_MODULATE already does the right thing for alpha-only textures
+		setEnabled(GL_TEXTURE_2D, texture != 0);
+
+		const GLuint program = texture != 0 && shader == SHADER_SDF && SDFShader::load() ? SDFShader::program : 0;
+		if(program != currentProgram)
+		{
+			SDFShader::useProgram(program);
+			currentProgram = program;
+			countGLCalls(1);
+		}
+
+		if(!hasModelview || modelview.matrix() != transform.matrix())
+		{
+			glLoadMatrixf((const GLfloat*)transform.data());
+			modelview = transform;
+			hasModelview = true;
+			countGLCalls(1);
+		}
+	}
+};
@@ -9,10 +9,6 @@
 #include "../data/Resources.h"
 #include "Settings.h"
 
-#ifdef USE_OPENGL_ES
-	#define glOrtho glOrthof
-#endif
-
 namespace Renderer
 {
 	static bool initialCursorState;
@@ -49,7 +45,10 @@ namespace Renderer
 		//SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
 		//SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 2);
 
-#ifdef USE_OPENGL_ES
+#if defined(USE_OPENGL_ES) && defined(USE_OPENGL_SHADERS)
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+#elif defined(USE_OPENGL_ES)
 		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 1);
 #endif
 
@@ -116,10 +115,26 @@ namespace Renderer
 
 	void swapBuffers()
 	{
+		flush();
+		endFrame();
 		SDL_GL_SwapWindow(sdlWindow);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	}
 
+	unsigned int getRefreshRate()
+	{
+		SDL_DisplayMode dispMode;
+		if(sdlWindow == NULL || SDL_GetWindowDisplayMode(sdlWindow, &dispMode) != 0 || dispMode.refresh_rate <= 0)
+			return 60;
+
+		return dispMode.refresh_rate;
+	}
+
+	bool isVSyncEnabled()
+	{
+		return sdlContext != NULL && SDL_GL_GetSwapInterval() != 0;
+	}
+
 	void destroySurface()
 	{
 		SDL_GL_DeleteContext(sdlContext);
@@ -147,17 +162,22 @@ namespace Renderer
 			return false;
 
 		glViewport(0, 0, display_width, display_height);
-
-		glMatrixMode(GL_PROJECTION);
-		glOrtho(0, display_width, display_height, 0, -1.0, 1.0);
-		glMatrixMode(GL_MODELVIEW);
 		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+		resetState();
+
+		if(!initPipeline())
+		{
+			destroySurface();
+			return false;
+		}
 
 		return true;
 	}
 
 	void deinit()
 	{
+		deinitPipeline();
+		deinitVertexBuffer();
 		destroySurface();
 	}
 };
@@ -0,0 +1,375 @@
+#include "Renderer.h"
+#include "platform.h"
+#include GLHEADER
+#include "Log.h"
+#include <SDL.h>
+#include <stdlib.h>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#define GL_VERTEX_SHADER 0x8B31
+#define GL_COMPILE_STATUS 0x8B81
+#define GL_LINK_STATUS 0x8B82
+#endif
+
+#define ATTRIB_POS 0
+#define ATTRIB_TEX 1
+#define ATTRIB_COLOR 2
+
+#ifdef USE_OPENGL_ES
+	// all core in OpenGL ES 2.0
+	#define createShader glCreateShader
+	#define shaderSource glShaderSource
+	#define compileShader glCompileShader
+	#define getShaderiv glGetShaderiv
+	#define getShaderInfoLog glGetShaderInfoLog
+	#define deleteShader glDeleteShader
+	#define createProgram glCreateProgram
+	#define attachShader glAttachShader
+	#define bindAttribLocation glBindAttribLocation
+	#define linkProgram glLinkProgram
+	#define getProgramiv glGetProgramiv
+	#define getProgramInfoLog glGetProgramInfoLog
+	#define useProgram glUseProgram
+	#define deleteProgram glDeleteProgram
+	#define getUniformLocation glGetUniformLocation
+	#define uniformMatrix4fv glUniformMatrix4fv
+	#define enableVertexAttribArray glEnableVertexAttribArray
+	#define disableVertexAttribArray glDisableVertexAttribArray
+	#define vertexAttribPointer glVertexAttribPointer
+#else
+	typedef GLuint (APIENTRY *CreateShaderProc)(GLenum type);
+	typedef void (APIENTRY *ShaderSourceProc)(GLuint shader, GLsizei count, const char* const* string, const GLint* length);
+	typedef void (APIENTRY *CompileShaderProc)(GLuint shader);
+	typedef void (APIENTRY *GetShaderivProc)(GLuint shader, GLenum pname, GLint* params);
+	typedef void (APIENTRY *GetShaderInfoLogProc)(GLuint shader, GLsizei bufSize, GLsizei* length, char* infoLog);
+	typedef void (APIENTRY *DeleteShaderProc)(GLuint shader);
+	typedef GLuint (APIENTRY *CreateProgramProc)();
+	typedef void (APIENTRY *AttachShaderProc)(GLuint program, GLuint shader);
+	typedef void (APIENTRY *BindAttribLocationProc)(GLuint program, GLuint index, const char* name);
+	typedef void (APIENTRY *LinkProgramProc)(GLuint program);
+	typedef void (APIENTRY *GetProgramivProc)(GLuint program, GLenum pname, GLint* params);
+	typedef void (APIENTRY *GetProgramInfoLogProc)(GLuint program, GLsizei bufSize, GLsizei* length, char* infoLog);
+	typedef void (APIENTRY *UseProgramProc)(GLuint program);
+	typedef void (APIENTRY *DeleteProgramProc)(GLuint program);
+	typedef GLint (APIENTRY *GetUniformLocationProc)(GLuint program, const char* name);
+	typedef void (APIENTRY *UniformMatrix4fvProc)(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+	typedef void (APIENTRY *EnableVertexAttribArrayProc)(GLuint index);
+	typedef void (APIENTRY *DisableVertexAttribArrayProc)(GLuint index);
+	typedef void (APIENTRY *VertexAttribPointerProc)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer);
+
+	static CreateShaderProc createShader = NULL;
+	static ShaderSourceProc shaderSource = NULL;
+	static CompileShaderProc compileShader = NULL;
+	static GetShaderivProc getShaderiv = NULL;
+	static GetShaderInfoLogProc getShaderInfoLog = NULL;
+	static DeleteShaderProc deleteShader = NULL;
+	static CreateProgramProc createProgram = NULL;
+	static AttachShaderProc attachShader = NULL;
+	static BindAttribLocationProc bindAttribLocation = NULL;
+	static LinkProgramProc linkProgram = NULL;
+	static GetProgramivProc getProgramiv = NULL;
+	static GetProgramInfoLogProc getProgramInfoLog = NULL;
+	static UseProgramProc useProgram = NULL;
+	static DeleteProgramProc deleteProgram = NULL;
+	static GetUniformLocationProc getUniformLocation = NULL;
+	static UniformMatrix4fvProc uniformMatrix4fv = NULL;
+	static EnableVertexAttribArrayProc enableVertexAttribArray = NULL;
+	static DisableVertexAttribArrayProc disableVertexAttribArray = NULL;
+	static VertexAttribPointerProc vertexAttribPointer = NULL;
+#endif
+
+// GLSL ES 1.00 and GLSL 1.20 only differ in the header, the rest is shared
+#ifdef USE_OPENGL_ES
+	#define SHADER_HEADER "#version 100\n" "precision mediump float;\n"
+	#define SDF_SHADER_HEADER "#version 100\n" "#extension GL_OES_standard_derivatives : enable\n" "precision mediump float;\n"
+#else
+	#define SHADER_HEADER "#version 120\n"
+	#define SDF_SHADER_HEADER "#version 120\n"
+#endif
+
+static const char* vertexSource =
+	SHADER_HEADER
+	"uniform mat4 mvp;\n"
+	"attribute vec2 pos;\n"
+	"attribute vec2 tex;\n"
+	"attribute vec4 color;\n"
+	"varying vec2 vTex;\n"
+	"varying vec4 vColor;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = mvp * vec4(pos, 0.0, 1.0);\n"
+	"	vTex = tex;\n"
+	"	vColor = color;\n"
+	"}\n";
+
+static const char* colorSource =
+	SHADER_HEADER
+	"varying vec4 vColor;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = vColor;\n"
+	"}\n";
+
+static const char* textureSource =
+	SHADER_HEADER
+	"uniform sampler2D sampler;\n"
+	"varying vec2 vTex;\n"
+	"varying vec4 vColor;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = vColor * texture2D(sampler, vTex);\n"
+	"}\n";
+
+// alpha-only textures read as (0, 0, 0, a), the color has to come from the vertex alone (like GL_MODULATE does it)
+static const char* alphaTextureSource =
+	SHADER_HEADER
+	"uniform sampler2D sampler;\n"
+	"varying vec2 vTex;\n"
+	"varying vec4 vColor;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = vec4(vColor.rgb, vColor.a * texture2D(sampler, vTex).a);\n"
+	"}\n";
+
+static const char* sdfSource =
+	SDF_SHADER_HEADER
+	"uniform sampler2D sampler;\n"
+	"varying vec2 vTex;\n"
+	"varying vec4 vColor;\n"
+	"void main()\n"
+	"{\n"
+	"	float distance = texture2D(sampler, vTex).a;\n"
+	"	float width = fwidth(distance) * 0.75;\n"
+	"	float alpha = smoothstep(0.5 - width, 0.5 + width, distance);\n"
+	"	gl_FragColor = vec4(vColor.rgb, vColor.a * alpha);\n"
+	"}\n";
+
+namespace Renderer
+{
+	struct Program
+	{
+		Program() : id(0), mvpLocation(-1), hasTransform(false) {}
+
+		GLuint id;
+		GLint mvpLocation;
+		bool hasTransform; // transform has been uploaded since the program was linked
+		Eigen::Affine3f transform;
+	};
+
+	Program colorProgram; // untextured draws, whatever the shader
+	Program programs[SHADER_SDF + 1];
+	bool sdfBroken = false; // compiling failed once, don't try again
+	Program* currentProgram = NULL;
+	bool arraysEnabled = false;
+	Eigen::Matrix4f projection;
+
+	static bool loadFunctions()
+	{
+#ifdef USE_OPENGL_ES
+		return true;
+#else
+		const char* version = (const char*)glGetString(GL_VERSION);
+		if(!version || atoi(version) < 2)
+			return false;
+
+		createShader = (CreateShaderProc)SDL_GL_GetProcAddress("glCreateShader");
+		shaderSource = (ShaderSourceProc)SDL_GL_GetProcAddress("glShaderSource");
+		compileShader = (CompileShaderProc)SDL_GL_GetProcAddress("glCompileShader");
+		getShaderiv = (GetShaderivProc)SDL_GL_GetProcAddress("glGetShaderiv");
+		getShaderInfoLog = (GetShaderInfoLogProc)SDL_GL_GetProcAddress("glGetShaderInfoLog");
+		deleteShader = (DeleteShaderProc)SDL_GL_GetProcAddress("glDeleteShader");
+		createProgram = (CreateProgramProc)SDL_GL_GetProcAddress("glCreateProgram");
+		attachShader = (AttachShaderProc)SDL_GL_GetProcAddress("glAttachShader");
+		bindAttribLocation = (BindAttribLocationProc)SDL_GL_GetProcAddress("glBindAttribLocation");
+		linkProgram = (LinkProgramProc)SDL_GL_GetProcAddress("glLinkProgram");
+		getProgramiv = (GetProgramivProc)SDL_GL_GetProcAddress("glGetProgramiv");
+		getProgramInfoLog = (GetProgramInfoLogProc)SDL_GL_GetProcAddress("glGetProgramInfoLog");
+		useProgram = (UseProgramProc)SDL_GL_GetProcAddress("glUseProgram");
+		deleteProgram = (DeleteProgramProc)SDL_GL_GetProcAddress("glDeleteProgram");
+		getUniformLocation = (GetUniformLocationProc)SDL_GL_GetProcAddress("glGetUniformLocation");
+		uniformMatrix4fv = (UniformMatrix4fvProc)SDL_GL_GetProcAddress("glUniformMatrix4fv");
+		enableVertexAttribArray = (EnableVertexAttribArrayProc)SDL_GL_GetProcAddress("glEnableVertexAttribArray");
+		disableVertexAttribArray = (DisableVertexAttribArrayProc)SDL_GL_GetProcAddress("glDisableVertexAttribArray");
+		vertexAttribPointer = (VertexAttribPointerProc)SDL_GL_GetProcAddress("glVertexAttribPointer");
+
+		return createShader && shaderSource && compileShader && getShaderiv && getShaderInfoLog && deleteShader &&
+			createProgram && attachShader && bindAttribLocation && linkProgram && getProgramiv && getProgramInfoLog &&
+			useProgram && deleteProgram && getUniformLocation && uniformMatrix4fv &&
+			enableVertexAttribArray && disableVertexAttribArray && vertexAttribPointer;
+#endif
+	}
+
+	static GLuint compile(GLenum type, const char* source)
+	{
+		GLuint shader = createShader(type);
+		shaderSource(shader, 1, &source, NULL);
+		compileShader(shader);
+
+		GLint ok = 0;
+		getShaderiv(shader, GL_COMPILE_STATUS, &ok);
+		if(!ok)
+		{
+			char log[512] = "";
+			getShaderInfoLog(shader, sizeof(log), NULL, log);
+			LOG(LogError) << "Error compiling shader:\n" << log;
+
+			deleteShader(shader);
+			return 0;
+		}
+
+		return shader;
+	}
+
+	static bool link(Program& program, const char* fragmentSource)
+	{
+		GLuint vertexShader = compile(GL_VERTEX_SHADER, vertexSource);
+		GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, fragmentSource);
+		if(vertexShader && fragmentShader)
+		{
+			program.id = createProgram();
+			attachShader(program.id, vertexShader);
+			attachShader(program.id, fragmentShader);
+
+			// the same locations in every program, setVertexPointers() doesn't need to know which one is used
+			bindAttribLocation(program.id, ATTRIB_POS, "pos");
+			bindAttribLocation(program.id, ATTRIB_TEX, "tex");
+			bindAttribLocation(program.id, ATTRIB_COLOR, "color");
+			linkProgram(program.id);
+
+			GLint ok = 0;
+			getProgramiv(program.id, GL_LINK_STATUS, &ok);
+			if(!ok)
+			{
+				char log[512] = "";
+				getProgramInfoLog(program.id, sizeof(log), NULL, log);
+				LOG(LogError) << "Error linking shader program:\n" << log;
+
+				deleteProgram(program.id);
+				program.id = 0;
+			}
+		}
+
+		if(vertexShader)
+			deleteShader(vertexShader);
+		if(fragmentShader)
+			deleteShader(fragmentShader);
+
+		if(program.id == 0)
+			return false;
+
+		// the sampler uniform stays at texture unit 0
+		program.mvpLocation = getUniformLocation(program.id, "mvp");
+		program.hasTransform = false;
+		return true;
+	}
+
+	static void unlink(Program& program)
+	{
+		if(program.id != 0)
+			deleteProgram(program.id);
+
+		program = Program();
+	}
+
+	bool initPipeline()
+	{
+		if(!loadFunctions())
+		{
+			LOG(LogError) << "The shader renderer needs OpenGL 2.0 or OpenGL ES 2.0!";
+			return false;
+		}
+
+		if(!link(colorProgram, colorSource) || !link(programs[SHADER_DEFAULT], textureSource) || !link(programs[SHADER_ALPHA_TEXTURE], alphaTextureSource))
+		{
+			deinitPipeline();
+			return false;
+		}
+
+		// same as glOrtho(0, width, height, 0, -1, 1)
+		const float width = (float)getScreenWidth();
+		const float height = (float)getScreenHeight();
+		projection << 2 / width, 0, 0, -1,
+			0, -2 / height, 0, 1,
+			0, 0, -1, 0,
+			0, 0, 0, 1;
+
+		return true;
+	}
+
+	void deinitPipeline()
+	{
+		if(currentProgram != NULL)
+			useProgram(0);
+		currentProgram = NULL;
+		arraysEnabled = false;
+
+		unlink(colorProgram);
+		for(int i = 0; i <= SHADER_SDF; i++)
+			unlink(programs[i]);
+	}
+
+	bool hasShader(Shader shader)
+	{
+		if(shader != SHADER_SDF || programs[SHADER_SDF].id != 0)
+			return true;
+		if(sdfBroken || colorProgram.id == 0)
+			return false;
+
+		// compiled on first use, GLES 2.0 needs the (optional) derivatives extension for it
+		if(!link(programs[SHADER_SDF], sdfSource))
+		{
+			LOG(LogError) << "Could not compile the SDF font shader, using bitmap fonts instead";
+			sdfBroken = true;
+			return false;
+		}
+
+		return true;
+	}
+
+	void setVertexPointers(const GLubyte* base)
+	{
+		// every draw comes from a Vertex array, so they never need to be disabled again
+		if(!arraysEnabled)
+		{
+			enableVertexAttribArray(ATTRIB_POS);
+			enableVertexAttribArray(ATTRIB_TEX);
+			enableVertexAttribArray(ATTRIB_COLOR);
+			arraysEnabled = true;
+			countGLCalls(3);
+		}
+
+		vertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), base);
+		vertexAttribPointer(ATTRIB_TEX, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), base + sizeof(Eigen::Vector2f));
+		vertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), base + sizeof(Eigen::Vector2f) * 2);
+		countGLCalls(3);
+	}
+
+	void setDrawState(GLuint texture, Shader shader, const Eigen::Affine3f& transform)
+	{
+		Program* program = &colorProgram;
+		if(texture != 0)
+			program = hasShader(shader) ? &programs[shader] : &programs[SHADER_ALPHA_TEXTURE];
+
+		if(program != currentProgram)
+		{
+			useProgram(program->id);
+			currentProgram = program;
+			countGLCalls(1);
+		}
+
+		// uniforms belong to the program, so each one remembers what it was given last
+		if(!program->hasTransform || program->transform.matrix() != transform.matrix())
+		{
+			const Eigen::Matrix4f mvp = projection * transform.matrix();
+			uniformMatrix4fv(program->mvpLocation, 1, GL_FALSE, mvp.data());
+			program->transform = transform;
+			program->hasTransform = true;
+			countGLCalls(1);
+		}
+	}
+};
@@ -41,6 +41,7 @@ void Settings::setDefaults()
 	mBoolMap["BackgroundJoystickInput"] = false;
 	mBoolMap["ParseGamelistOnly"] = false;
 	mBoolMap["DrawFramerate"] = false;
+	mBoolMap["Profiler"] = false;
 	mBoolMap["ShowExit"] = true;
 	mBoolMap["Windowed"] = false;
 
@@ -59,6 +60,17 @@ void Settings::setDefaults()
 	mBoolMap["HideConsole"] = true;
 	mBoolMap["QuickSystemSelect"] = true;
 	mBoolMap["SaveGamelistsOnExit"] = true;
+	mBoolMap["TextureDiskCache"] = true;
+
+#ifdef _RPI_
+	// memory is tight on the Pi, reload textures from their files (or the disk cache) instead
+	mBoolMap["TextureShadowCopies"] = false;
+#else
+	mBoolMap["TextureShadowCopies"] = true;
+#endif
+
+	mBoolMap["FontSDF"] = false; // one set of distance field glyphs for every font size (needs OpenGL 2.0, ignored on GLES)
+	mBoolMap["FontKerning"] = false; // changes text widths, so themes may need adjusting
 
 	mBoolMap["Debug"] = false;
 	mBoolMap["DebugGrid"] = false;
@@ -67,6 +79,7 @@ void Settings::setDefaults()
 	mIntMap["ScreenSaverTime"] = 5*60*1000; // 5 minutes
 	mIntMap["ScraperResizeWidth"] = 400;
 	mIntMap["ScraperResizeHeight"] = 0;
+	mIntMap["TextureDiskCacheSize"] = 1024; // MB, the least recently used images are evicted past that
 
 	mStringMap["TransitionStyle"] = "fade";
 	mStringMap["ThemeSet"] = "";
@@ -31,6 +31,7 @@ std::map< std::string, ElementMapType > ThemeData::sElementMap = boost::assign::
 		("origin", NORMALIZED_PAIR)
 		("path", PATH)
 		("tile", BOOLEAN)
+		("mipmap", BOOLEAN)
 		("color", COLOR)))
 	("text", makeMap(boost::assign::map_list_of
 		("pos", NORMALIZED_PAIR)
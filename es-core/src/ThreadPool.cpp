@@ -0,0 +1,58 @@
+#include "ThreadPool.h"
+#include "Log.h"
+
+std::unique_ptr<ThreadPool> ThreadPool::sInstance;
+
+ThreadPool* ThreadPool::getInstance()
+{
+	if(!sInstance)
+	{
+		// leave a core for the main thread
+		const unsigned int cores = std::thread::hardware_concurrency();
+		sInstance = std::unique_ptr<ThreadPool>(new ThreadPool(cores > 1 ? cores - 1 : 1));
+	}
+
+	return sInstance.get();
+}
+
+ThreadPool::ThreadPool(size_t threadCount) : mStopping(false)
+{
+	LOG(LogInfo) << "Starting " << threadCount << " worker thread(s)";
+
+	for(size_t i = 0; i < threadCount; i++)
+		mThreads.push_back(std::thread(&ThreadPool::work, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mCondition.notify_all();
+
+	for(auto it = mThreads.begin(); it != mThreads.end(); it++)
+		it->join();
+}
+
+void ThreadPool::work()
+{
+	while(true)
+	{
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+
+			// unfinished jobs are dropped when stopping, their futures report a broken promise
+			if(mStopping)
+				return;
+
+			job = std::move(mJobs.front());
+			mJobs.pop();
+		}
+
+		job();
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+// A fixed set of worker threads for CPU-heavy work that doesn't touch OpenGL (e.g. rasterizing SVGs).
+// Jobs must not wait on other jobs - with every worker waiting, nothing would be left to run them.
+class ThreadPool
+{
+public:
+	static ThreadPool* getInstance();
+
+	~ThreadPool();
+
+	inline size_t getThreadCount() const { return mThreads.size(); }
+
+	// Runs func on a worker. The returned future does not block when destroyed, unlike one from std::async.
+	template<typename F>
+	std::future<typename std::result_of<F()>::type> queue(F func)
+	{
+		typedef typename std::result_of<F()>::type ResultType;
+
+		std::shared_ptr< std::packaged_task<ResultType()> > task(new std::packaged_task<ResultType()>(std::move(func)));
+		std::future<ResultType> future = task->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mJobs.push([task] { (*task)(); });
+		}
+		mCondition.notify_one();
+
+		return future;
+	}
+
+private:
+	ThreadPool(size_t threadCount);
+
+	void work();
+
+	static std::unique_ptr<ThreadPool> sInstance;
+
+	std::vector<std::thread> mThreads;
+	std::queue< std::function<void()> > mJobs;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mStopping;
+};
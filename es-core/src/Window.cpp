@@ -7,8 +7,10 @@
 #include <iomanip>
 #include "components/HelpComponent.h"
 #include "components/ImageComponent.h"
+#include "Profiler.h"
+#include "resources/RenderTarget.h"
 
-Window::Window() : mNormalizeNextUpdate(false), mFrameTimeElapsed(0), mFrameCountElapsed(0), mAverageDeltaTime(10), 
+Window::Window() : mFrameTimeElapsed(0), mFrameCountElapsed(0), mAverageDeltaTime(10), mNormalizeNextUpdate(false), mDirty(true),
 	mAllowSleep(true), mSleeping(false), mTimeSinceLastInput(0)
 {
 	mHelp = new HelpComponent(this);
@@ -31,6 +33,7 @@ void Window::pushGui(GuiComponent* gui)
 {
 	mGuiStack.push_back(gui);
 	gui->updateHelpPrompts();
+	markDirty();
 }
 
 void Window::removeGui(GuiComponent* gui)
@@ -40,6 +43,7 @@ void Window::removeGui(GuiComponent* gui)
 		if(*i == gui)
 		{
 			i = mGuiStack.erase(i);
+			markDirty();
 
 			if(i == mGuiStack.end() && mGuiStack.size()) // we just popped the stack and the stack is not empty
 				mGuiStack.back()->updateHelpPrompts();
@@ -65,6 +69,8 @@ bool Window::init(unsigned int width, unsigned int height)
 		return false;
 	}
 
+	mFrameTimer.setRefreshRate(Renderer::getRefreshRate());
+
 	InputManager::getInstance()->init();
 
 	ResourceManager::getInstance()->reloadAll();
@@ -83,6 +89,7 @@ bool Window::init(unsigned int width, unsigned int height)
 	if(peekGui())
 		peekGui()->updateHelpPrompts();
 
+	markDirty();
 	return true;
 }
 
@@ -95,6 +102,7 @@ void Window::deinit()
 
 void Window::textInput(const char* text)
 {
+	markDirty();
 	if(peekGui())
 		peekGui()->textInput(text);
 }
@@ -111,6 +119,7 @@ void Window::input(InputConfig* config, Input input)
 	}
 
 	mTimeSinceLastInput = 0;
+	markDirty(); // most input changes something on screen
 
 	if(config->getDeviceId() == DEVICE_KEYBOARD && input.value && input.id == SDLK_g && SDL_GetModState() & KMOD_LCTRL && Settings::getInstance()->getBool("Debug"))
 	{
@@ -131,6 +140,8 @@ void Window::input(InputConfig* config, Input input)
 
 void Window::update(int deltaTime)
 {
+	Profiler::beginFrame();
+
 	if(mNormalizeNextUpdate)
 	{
 		mNormalizeNextUpdate = false;
@@ -144,31 +155,49 @@ void Window::update(int deltaTime)
 	{
 		mAverageDeltaTime = mFrameTimeElapsed / mFrameCountElapsed;
 		
-		if(Settings::getInstance()->getBool("DrawFramerate"))
+		if(Settings::getInstance()->getBool("DrawFramerate") || Profiler::isEnabled())
 		{
 			std::stringstream ss;
 			
 			// fps
 			ss << std::fixed << std::setprecision(1) << (1000.0f * (float)mFrameCountElapsed / (float)mFrameTimeElapsed) << "fps, ";
-			ss << std::fixed << std::setprecision(2) << ((float)mFrameTimeElapsed / (float)mFrameCountElapsed) << "ms";
+			ss << std::fixed << std::setprecision(2) << ((float)mFrameTimeElapsed / (float)mFrameCountElapsed) << "ms, ";
+			ss << Renderer::getDrawCallCount() << " draws, " << Renderer::getGLCallCount() << " GL calls, " << GuiComponent::getCulledCount() << " culled";
+			ss << "\n" << mFrameTimer.getHistogram();
 
 			// vram
 			float textureVramUsageMb = TextureResource::getTotalMemUsage() / 1000.0f / 1000.0f;;
 			float fontVramUsageMb = Font::getTotalMemUsage() / 1000.0f / 1000.0f;;
-			float totalVramUsageMb = textureVramUsageMb + fontVramUsageMb;
-			ss << "\nVRAM: " << totalVramUsageMb << "mb (texs: " << textureVramUsageMb << "mb, fonts: " << fontVramUsageMb << "mb)";
+			float targetVramUsageMb = RenderTarget::getTotalMemUsage() / 1000.0f / 1000.0f;
+			float totalVramUsageMb = textureVramUsageMb + fontVramUsageMb + targetVramUsageMb;
+			ss << "\nVRAM: " << totalVramUsageMb << "mb (texs: " << textureVramUsageMb << "mb, fonts: " << fontVramUsageMb << "mb, render targets: " << targetVramUsageMb << "mb)";
+
+			// glyph texture sizes and how full they are
+			ss << "\n" << Font::getAtlasUsage();
+
+			if(Profiler::isEnabled())
+				ss << "\n" << Profiler::getReport();
 
 			mFrameDataText = std::unique_ptr<TextCache>(mDefaultFonts.at(1)->buildTextCache(ss.str(), 50.f, 50.f, 0xFF00FFFF));
 		}
 
 		mFrameTimeElapsed = 0;
 		mFrameCountElapsed = 0;
+
+		Font::releaseIdleFaces();
 	}
 
 	mTimeSinceLastInput += deltaTime;
 
+	// the framerate overlay is meant to measure full speed rendering, and render() is what puts us to sleep
+	if(Settings::getInstance()->getBool("DrawFramerate") || Profiler::isEnabled() || isScreenSaverDue())
+		markDirty();
+
 	if(peekGui())
+	{
+		Profiler::Scope scope(Profiler::UPDATE, peekGui());
 		peekGui()->update(deltaTime);
+	}
 }
 
 void Window::render()
@@ -183,10 +212,16 @@ void Window::render()
 		auto& bottom = mGuiStack.front();
 		auto& top = mGuiStack.back();
 
-		bottom->render(transform);
+		{
+			Profiler::Scope scope(Profiler::RENDER, bottom);
+			bottom->render(transform);
+		}
+
 		if(bottom != top)
 		{
 			mBackgroundOverlay->render(transform);
+
+			Profiler::Scope scope(Profiler::RENDER, top);
 			top->render(transform);
 		}
 	}
@@ -194,19 +229,27 @@ void Window::render()
 	if(!mRenderedHelpPrompts)
 		mHelp->render(transform);
 
-	if(Settings::getInstance()->getBool("DrawFramerate") && mFrameDataText)
+	if((Settings::getInstance()->getBool("DrawFramerate") || Profiler::isEnabled()) && mFrameDataText)
 	{
 		Renderer::setMatrix(Eigen::Affine3f::Identity());
 		mDefaultFonts.at(1)->renderTextCache(mFrameDataText.get());
 	}
 
-	unsigned int screensaverTime = (unsigned int)Settings::getInstance()->getInt("ScreenSaverTime");
-	if(mTimeSinceLastInput >= screensaverTime && screensaverTime != 0 && mAllowSleep)
+	if(isScreenSaverDue())
 	{
 		// go to sleep
 		mSleeping = true;
 		onSleep();
 	}
+
+	GuiComponent::endFrame();
+	mDirty = false;
+}
+
+bool Window::isScreenSaverDue() const
+{
+	unsigned int screensaverTime = (unsigned int)Settings::getInstance()->getInt("ScreenSaverTime");
+	return mTimeSinceLastInput >= screensaverTime && screensaverTime != 0 && mAllowSleep;
 }
 
 void Window::normalizeNextUpdate()
@@ -320,6 +363,7 @@ void Window::setHelpPrompts(const std::vector<HelpPrompt>& prompts, const HelpSt
 	});
 
 	mHelp->setPrompts(addPrompts);
+	markDirty();
 }
 
 
@@ -332,5 +376,5 @@ void Window::onSleep()
 
 void Window::onWake()
 {
-
+	markDirty();
 }
@@ -4,6 +4,7 @@
 #include <vector>
 #include "resources/Font.h"
 #include "InputManager.h"
+#include "FrameTimer.h"
 
 class HelpComponent;
 class ImageComponent;
@@ -28,6 +29,12 @@ public:
 
 	void normalizeNextUpdate();
 
+	inline FrameTimer& getFrameTimer() { return mFrameTimer; } // main() gets the delta times for update() from it
+
+	// render() only needs to be called after something changed, see GuiComponent::markDirty()
+	inline void markDirty() { mDirty = true; }
+	inline bool isDirty() const { return mDirty; }
+
 	inline bool isSleeping() const { return mSleeping; }
 	bool getAllowSleep();
 	void setAllowSleep(bool sleep);
@@ -40,6 +47,7 @@ public:
 private:
 	void onSleep();
 	void onWake();
+	bool isScreenSaverDue() const;
 
 	HelpComponent* mHelp;
 	ImageComponent* mBackgroundOverlay;
@@ -53,8 +61,10 @@ private:
 	int mAverageDeltaTime;
 
 	std::unique_ptr<TextCache> mFrameDataText;
+	FrameTimer mFrameTimer;
 
 	bool mNormalizeNextUpdate;
+	bool mDirty;
 
 	bool mAllowSleep;
 	bool mSleeping;
@@ -52,6 +52,7 @@ void AnimatedImageComponent::update(int deltaTime)
 	if(!mEnabled || mFrames.size() == 0)
 		return;
 
+	markDirty(); // frames are short, redraw every frame instead of waking up late for the next one
 	mFrameAccumulator += deltaTime;
 
 	while(mFrames.at(mCurrentFrame).second <= mFrameAccumulator)
@@ -86,7 +86,7 @@ void ButtonComponent::updateImage()
 
 void ButtonComponent::render(const Eigen::Affine3f& parentTrans)
 {
-	Eigen::Affine3f trans = roundMatrix(parentTrans * getTransform());
+	Eigen::Affine3f trans = getWorldTransform(parentTrans, true);
 	
 	mBox.render(trans);
 
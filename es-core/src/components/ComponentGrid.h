@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GuiComponent.h"
+#include "Renderer.h"
 
 namespace GridFlags
 {
@@ -93,15 +94,7 @@ private:
 	float* mRowHeights;
 	float* mColWidths;
 	
-	struct Vert
-	{
-		Vert(float xi = 0, float yi = 0) : x(xi), y(yi) {};
-		float x;
-		float y;
-	};
-
-	std::vector<Vert> mLines;
-	std::vector<unsigned int> mLineColors;
+	std::vector<Renderer::Vertex> mLines;
 
 	// Update position & size
 	void updateCellComponent(const GridEntry& cell);
@@ -1,8 +1,11 @@
 #include "components/ComponentList.h"
 #include "Util.h"
 #include "Log.h"
+#include <algorithm>
 
 #define TOTAL_HORIZONTAL_PADDING_PX 20
+#define VIRTUAL_ROW_MARGIN 1 // rows made past each edge of the view, so the next one is there before it scrolls in
+#define MAX_RECYCLED_ROWS 4
 
 ComponentList::ComponentList(Window* window) : IList<ComponentListRow, void*>(window, LIST_SCROLL_STYLE_SLOW, LIST_NEVER_LOOP)
 {
@@ -24,7 +27,7 @@ void ComponentList::addRow(const ComponentListRow& row, bool setCursorHere)
 		addChild(it->component.get());
 
 	updateElementSize(mEntries.back().data);
-	updateElementPosition(mEntries.back().data);
+	updateElementPosition(mEntries.size() - 1);
 
 	if(setCursorHere)
 	{
@@ -33,12 +36,151 @@ void ComponentList::addRow(const ComponentListRow& row, bool setCursorHere)
 	}
 }
 
-void ComponentList::onSizeChanged()
+void ComponentList::setDataSource(const std::shared_ptr<ComponentListDataSource>& source, int cursor)
 {
 	for(auto it = mEntries.begin(); it != mEntries.end(); it++)
+		releaseRow(it->data);
+
+	mDataSource = nullptr;
+	mRecycledRows.clear();
+	mVirtualRows.clear();
+	mRowOffsets.clear();
+	clear();
+
+	mDataSource = source;
+	if(!mDataSource)
+		return;
+
+	// empty rows, the ones in view get filled by updateVirtualRows()
+	IList<ComponentListRow, void*>::Entry e;
+	e.name = "";
+	e.object = NULL;
+	mEntries.resize(mDataSource->getRowCount(), e);
+	updateRowOffsets();
+
+	mCursor = std::max(0, std::min(cursor, size() - 1));
+	onCursorChanged(CURSOR_STOPPED);
+}
+
+void ComponentList::updateRowOffsets()
+{
+	mRowOffsets.resize(size() + 1);
+	mRowOffsets[0] = 0;
+	for(int i = 0; i < size(); i++)
+		mRowOffsets[i + 1] = mRowOffsets[i] + mDataSource->getRowHeight(i);
+}
+
+int ComponentList::getRowAt(float y) const
+{
+	const int row = (int)(std::upper_bound(mRowOffsets.begin(), mRowOffsets.end(), y) - mRowOffsets.begin()) - 1;
+	return std::max(0, std::min(row, size() - 1));
+}
+
+void ComponentList::updateVirtualRows()
+{
+	if(!mDataSource || !size())
+		return;
+
+	// the rows in view
+	int first = -1;
+	int last = -1;
+	if(mSize.y() > 0)
 	{
-		updateElementSize(it->data);
-		updateElementPosition(it->data);
+		first = std::max(getRowAt(mCameraOffset) - VIRTUAL_ROW_MARGIN, 0);
+		last = std::min(getRowAt(mCameraOffset + mSize.y()) + VIRTUAL_ROW_MARGIN, size() - 1);
+	}
+
+	// recycle the rows that left first, so the ones coming in can reuse them
+	std::vector<int> keep;
+	for(auto it = mVirtualRows.begin(); it != mVirtualRows.end(); it++)
+	{
+		if((*it >= first && *it <= last) || *it == mCursor)
+		{
+			keep.push_back(*it);
+			continue;
+		}
+
+		ComponentListRow& row = mEntries.at(*it).data;
+		releaseRow(row);
+		if(mRecycledRows.size() < MAX_RECYCLED_ROWS)
+			mRecycledRows.push_back(std::move(row));
+		row = ComponentListRow();
+	}
+	mVirtualRows.swap(keep);
+
+	for(int i = first; i <= last + 1; i++)
+	{
+		// the cursor's row goes last, it might be out of view
+		const int index = i <= last ? i : mCursor;
+		if(index < 0 || !mEntries.at(index).data.elements.empty())
+			continue;
+
+		ComponentListRow& row = mEntries.at(index).data;
+		bool bound = false;
+		if(!mRecycledRows.empty())
+		{
+			bound = mDataSource->bindRow(index, mRecycledRows.back());
+			if(bound)
+				row = std::move(mRecycledRows.back());
+			mRecycledRows.pop_back();
+		}
+
+		if(!bound)
+			row = mDataSource->createRow(index);
+
+		for(auto it = row.elements.begin(); it != row.elements.end(); it++)
+			addChild(it->component.get());
+
+		updateElementSize(row);
+		updateElementPosition(index);
+		mVirtualRows.push_back(index);
+	}
+}
+
+void ComponentList::refreshRows()
+{
+	if(!mDataSource)
+		return;
+
+	// row heights may have changed along with the data
+	updateRowOffsets();
+
+	std::vector<int> keep;
+	for(auto it = mVirtualRows.begin(); it != mVirtualRows.end(); it++)
+	{
+		ComponentListRow& row = mEntries.at(*it).data;
+		if(mDataSource->bindRow(*it, row))
+		{
+			updateElementSize(row);
+			updateElementPosition(*it);
+			keep.push_back(*it);
+		}else{
+			// made again by updateVirtualRows()
+			releaseRow(row);
+			row = ComponentListRow();
+		}
+	}
+	mVirtualRows.swap(keep);
+
+	onCursorChanged(CURSOR_STOPPED);
+}
+
+void ComponentList::releaseRow(ComponentListRow& row)
+{
+	for(auto it = row.elements.begin(); it != row.elements.end(); it++)
+		removeChild(it->component.get());
+}
+
+void ComponentList::onSizeChanged()
+{
+	for(int i = 0; i < size(); i++)
+	{
+		// virtual rows that aren't in view don't exist
+		if(mEntries.at(i).data.elements.empty())
+			continue;
+
+		updateElementSize(mEntries.at(i).data);
+		updateElementPosition(i);
 	}
 
 	updateCameraOffset();
@@ -107,19 +249,22 @@ void ComponentList::onCursorChanged(const CursorState& state)
 {
 	// update the selector bar position
 	// in the future this might be animated
-	mSelectorBarOffset = 0;
-	for(int i = 0; i < mCursor; i++)
-	{
-		mSelectorBarOffset += getRowHeight(mEntries.at(i).data);
-	}
+	mSelectorBarOffset = getRowOffset(mCursor);
 
 	updateCameraOffset();
 
 	// this is terribly inefficient but we don't know what we came from so...
 	if(size())
 	{
-		for(auto it = mEntries.begin(); it != mEntries.end(); it++)
-			it->data.elements.back().component->onFocusLost();
+		if(mDataSource)
+		{
+			// only these exist
+			for(auto it = mVirtualRows.begin(); it != mVirtualRows.end(); it++)
+				mEntries.at(*it).data.elements.back().component->onFocusLost();
+		}else{
+			for(auto it = mEntries.begin(); it != mEntries.end(); it++)
+				it->data.elements.back().component->onFocusLost();
+		}
 		
 		mEntries.at(mCursor).data.elements.back().component->onFocusGained();
 	}
@@ -136,15 +281,22 @@ void ComponentList::updateCameraOffset()
 	const float totalHeight = getTotalRowHeight();
 	if(totalHeight > mSize.y())
 	{
-		float target = mSelectorBarOffset + getRowHeight(mEntries.at(mCursor).data)/2 - (mSize.y() / 2);
+		float target = mSelectorBarOffset + getRowHeight(mCursor)/2 - (mSize.y() / 2);
 
 		// clamp it
-		mCameraOffset = 0;
-		unsigned int i = 0;
-		while(mCameraOffset < target && i < mEntries.size())
+		if(mDataSource)
 		{
-			mCameraOffset += getRowHeight(mEntries.at(i).data);
-			i++;
+			// the first row starting at or past target
+			auto it = std::lower_bound(mRowOffsets.begin(), mRowOffsets.end(), target);
+			mCameraOffset = it != mRowOffsets.end() ? *it : mRowOffsets.back();
+		}else{
+			mCameraOffset = 0;
+			int i = 0;
+			while(mCameraOffset < target && i < size())
+			{
+				mCameraOffset += getRowHeight(i);
+				i++;
+			}
 		}
 
 		if(mCameraOffset < 0)
@@ -154,6 +306,8 @@ void ComponentList::updateCameraOffset()
 	}else{
 		mCameraOffset = 0;
 	}
+
+	updateVirtualRows();
 }
 
 void ComponentList::render(const Eigen::Affine3f& parentTrans)
@@ -161,7 +315,7 @@ void ComponentList::render(const Eigen::Affine3f& parentTrans)
 	if(!size())
 		return;
 
-	Eigen::Affine3f trans = roundMatrix(parentTrans * getTransform());
+	Eigen::Affine3f trans = getWorldTransform(parentTrans, true);
 
 	// clip everything to be inside our bounds
 	Eigen::Vector3f dim(mSize.x(), mSize.y(), 0);
@@ -172,22 +326,33 @@ void ComponentList::render(const Eigen::Affine3f& parentTrans)
 	// scroll the camera
 	trans.translate(Eigen::Vector3f(0, -round(mCameraOffset), 0));
 
-	// draw our entries
+	// draw our entries, skipping the rows scrolled out of view
+	const Eigen::Vector4f clipBounds = Renderer::getClipBounds();
 	std::vector<GuiComponent*> drawAfterCursor;
-	bool drawAll;
-	for(unsigned int i = 0; i < mEntries.size(); i++)
+	auto renderRow = [&](int i)
 	{
 		auto& entry = mEntries.at(i);
-		drawAll = !mFocused || i != mCursor;
+		const bool drawAll = !mFocused || i != mCursor;
 		for(auto it = entry.data.elements.begin(); it != entry.data.elements.end(); it++)
 		{
 			if(drawAll || it->invert_when_selected)
 			{
-				it->component->render(trans);
+				if(!it->component->cull(trans, clipBounds))
+					it->component->render(trans);
 			}else{
 				drawAfterCursor.push_back(it->component.get());
 			}
 		}
+	};
+
+	// in virtual mode only a few rows exist
+	if(mDataSource)
+	{
+		for(auto it = mVirtualRows.begin(); it != mVirtualRows.end(); it++)
+			renderRow(*it);
+	}else{
+		for(int i = 0; i < size(); i++)
+			renderRow(i);
 	}
 
 	// custom rendering
@@ -201,7 +366,7 @@ void ComponentList::render(const Eigen::Affine3f& parentTrans)
 		// and 0xFFFFFF -> 0x777777
 		// (1 - dst) + 0x77
 	
-		const float selectedRowHeight = getRowHeight(mEntries.at(mCursor).data);
+		const float selectedRowHeight = getRowHeight(mCursor);
 		Renderer::drawRect(0.0f, mSelectorBarOffset, mSize.x(), selectedRowHeight, 0xFFFFFFFF,
 			GL_ONE_MINUS_DST_COLOR, GL_ZERO);
 		Renderer::drawRect(0.0f, mSelectorBarOffset, mSize.x(), selectedRowHeight, 0x777777FF,
@@ -219,14 +384,17 @@ void ComponentList::render(const Eigen::Affine3f& parentTrans)
 			Renderer::setMatrix(trans);
 	}
 
-	// draw separators
-	float y = 0;
-	for(unsigned int i = 0; i < mEntries.size(); i++)
+	// draw separators, the ones in view
+	int i = mDataSource ? getRowAt(mCameraOffset) : 0;
+	float y = getRowOffset(i);
+	for(; i <= size() && y < mCameraOffset + mSize.y(); i++)
 	{
-		Renderer::drawRect(0.0f, y, mSize.x(), 1.0f, 0xC6C7C6FF);
-		y += getRowHeight(mEntries.at(i).data);
+		if(y + 1 > mCameraOffset)
+			Renderer::drawRect(0.0f, y, mSize.x(), 1.0f, 0xC6C7C6FF);
+
+		if(i < size())
+			y += getRowHeight(i);
 	}
-	Renderer::drawRect(0.0f, y, mSize.x(), 1.0f, 0xC6C7C6FF);
 
 	Renderer::popClipRect();
 }
@@ -244,27 +412,48 @@ float ComponentList::getRowHeight(const ComponentListRow& row) const
 	return height;
 }
 
+float ComponentList::getRowHeight(int row) const
+{
+	// virtual rows might not exist yet
+	if(mDataSource)
+		return mRowOffsets.at(row + 1) - mRowOffsets.at(row);
+
+	return getRowHeight(mEntries.at(row).data);
+}
+
+float ComponentList::getRowOffset(int row) const
+{
+	if(mDataSource)
+		return mRowOffsets.at(row);
+
+	float y = 0;
+	for(int i = 0; i < row; i++)
+		y += getRowHeight(i);
+
+	return y;
+}
+
 float ComponentList::getTotalRowHeight() const
 {
+	if(mDataSource)
+		return mRowOffsets.back();
+
 	float height = 0;
-	for(auto it = mEntries.begin(); it != mEntries.end(); it++)
+	for(int i = 0; i < size(); i++)
 	{
-		height += getRowHeight(it->data);
+		height += getRowHeight(i);
 	}
 
 	return height;
 }
 
-void ComponentList::updateElementPosition(const ComponentListRow& row)
+void ComponentList::updateElementPosition(unsigned int index)
 {
-	float yOffset = 0;
-	for(auto it = mEntries.begin(); it != mEntries.end() && &it->data != &row; it++)
-	{
-		yOffset += getRowHeight(it->data);
-	}
+	float yOffset = getRowOffset(index);
 
 	// assumes updateElementSize has already been called
-	float rowHeight = getRowHeight(row);
+	const ComponentListRow& row = mEntries.at(index).data;
+	float rowHeight = getRowHeight(index);
 
 	float x = TOTAL_HORIZONTAL_PADDING_PX / 2;
 	for(unsigned int i = 0; i < row.elements.size(); i++)
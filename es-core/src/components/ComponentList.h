@@ -42,6 +42,22 @@ struct ComponentListRow
 	}
 };
 
+// Supplies the rows of a virtual ComponentList (see ComponentList::setDataSource()).
+// Only the rows in view exist: they're made as they scroll into view and handed back for reuse as they leave.
+class ComponentListDataSource
+{
+public:
+	virtual ~ComponentListDataSource() {}
+
+	virtual unsigned int getRowCount() = 0;
+	virtual float getRowHeight(unsigned int index) = 0; // rows are laid out before they're made, asked again by refreshRows()
+	virtual ComponentListRow createRow(unsigned int index) = 0; // needs at least one element
+
+	// Points row, made for a row that scrolled out of view, at index instead (its text, state, input handler...).
+	// Returning false drops it, createRow() is called instead.
+	virtual bool bindRow(unsigned int index, ComponentListRow& row) { return false; }
+};
+
 class ComponentList : public IList<ComponentListRow, void*>
 {
 public:
@@ -49,6 +65,11 @@ public:
 
 	void addRow(const ComponentListRow& row, bool setCursorHere = false);
 
+	// Virtual mode, for long lists: the rows come from source as they scroll into view instead of from addRow().
+	// Replaces all rows, nullptr clears them and goes back to addRow().
+	void setDataSource(const std::shared_ptr<ComponentListDataSource>& source, int cursor = 0);
+	void refreshRows(); // calls bindRow() again for the rows that exist, after what they show changed
+
 	void textInput(const char* text) override;
 	bool input(InputConfig* config, Input input) override;
 	void update(int deltaTime) override;
@@ -63,7 +84,7 @@ public:
 	inline int getCursorId() const { return mCursor; }
 	
 	float getTotalRowHeight() const;
-	inline float getRowHeight(int row) const { return getRowHeight(mEntries.at(row).data); }
+	float getRowHeight(int row) const;
 
 	inline void setCursorChangedCallback(const std::function<void(CursorState state)>& callback) { mCursorChangedCallback = callback; };
 	inline const std::function<void(CursorState state)>& getCursorChangedCallback() const { return mCursorChangedCallback; };
@@ -75,13 +96,25 @@ private:
 	bool mFocused;
 
 	void updateCameraOffset();
-	void updateElementPosition(const ComponentListRow& row);
+	void updateElementPosition(unsigned int index);
 	void updateElementSize(const ComponentListRow& row);
 	
 	float getRowHeight(const ComponentListRow& row) const;
 
+	float getRowOffset(int row) const; // where row starts, size() gives the total height
+
+	void updateVirtualRows(); // makes the rows in view (and the cursor's), recycles the rest
+	void updateRowOffsets();
+	int getRowAt(float y) const; // virtual mode only
+	void releaseRow(ComponentListRow& row);
+
 	float mSelectorBarOffset;
 	float mCameraOffset;
 
 	std::function<void(CursorState state)> mCursorChangedCallback;
+
+	std::shared_ptr<ComponentListDataSource> mDataSource;
+	std::vector<ComponentListRow> mRecycledRows;
+	std::vector<int> mVirtualRows; // the rows that exist
+	std::vector<float> mRowOffsets; // where each row starts, and the total height last (so positions don't need a sum over the rows above)
 };
@@ -136,7 +136,7 @@ void DateTimeComponent::update(int deltaTime)
 
 void DateTimeComponent::render(const Eigen::Affine3f& parentTrans)
 {
-	Eigen::Affine3f trans = parentTrans * getTransform();
+	Eigen::Affine3f trans = getWorldTransform(parentTrans);
 
 	if(mTextCache)
 	{
@@ -248,6 +248,8 @@ std::shared_ptr<Font> DateTimeComponent::getFont() const
 
 void DateTimeComponent::updateTextCache()
 {
+	markDirty();
+
 	DisplayMode mode = getCurrentDisplayMode();
 	const std::string dispString = mUppercase ? strToUpper(getDisplayString(mode)) : getDisplayString(mode);
 	std::shared_ptr<Font> font = getFont();
@@ -134,7 +134,7 @@ void HelpComponent::setOpacity(unsigned char opacity)
 
 void HelpComponent::render(const Eigen::Affine3f& parentTrans)
 {
-	Eigen::Affine3f trans = parentTrans * getTransform();
+	Eigen::Affine3f trans = getWorldTransform(parentTrans);
 	
 	if(mGrid)
 		mGrid->render(trans);
@@ -109,6 +109,7 @@ public:
 	{
 		mEntries.clear();
 		mCursor = 0;
+		markDirty();
 		listInput(0);
 		onCursorChanged(CURSOR_STOPPED);
 	}
@@ -129,6 +130,7 @@ public:
 	{
 		assert(it != mEntries.end());
 		mCursor = it - mEntries.begin();
+		markDirty();
 		onCursorChanged(CURSOR_STOPPED);
 	}
 
@@ -140,6 +142,7 @@ public:
 			if((*it).object == obj)
 			{
 				mCursor = it - mEntries.begin();
+				markDirty();
 				onCursorChanged(CURSOR_STOPPED);
 				return true;
 			}
@@ -152,6 +155,7 @@ public:
 	void add(const Entry& e)
 	{
 		mEntries.push_back(e);
+		markDirty();
 	}
 
 	bool remove(const UserData& obj)
@@ -180,6 +184,7 @@ protected:
 		}
 
 		mEntries.erase(it);
+		markDirty();
 	}
 
 
@@ -202,6 +207,7 @@ protected:
 	void listUpdate(int deltaTime)
 	{
 		// update the title overlay opacity
+		const unsigned char prevOpacity = mTitleOverlayOpacity;
 		const int dir = (mScrollTier >= mTierList.count - 1) ? 1 : -1; // fade in if scroll tier is >= 1, otherwise fade out
 		int op = mTitleOverlayOpacity + deltaTime*dir; // we just do a 1-to-1 time -> opacity, no scaling
 		if(op >= 255)
@@ -211,9 +217,14 @@ protected:
 		else
 			mTitleOverlayOpacity = (unsigned char)op;
 
+		if(mTitleOverlayOpacity != prevOpacity)
+			markDirty();
+
 		if(mScrollVelocity == 0 || size() < 2)
 			return;
 
+		markDirty(); // don't idle while the button is held, the next scroll step should happen on time
+
 		mScrollCursorAccumulator += deltaTime;
 		mScrollTierAccumulator += deltaTime;
 
@@ -296,6 +307,7 @@ protected:
 			onScroll(absAmt);
 
 		mCursor = cursor;
+		markDirty();
 		onCursorChanged((mScrollTier > 0) ? CURSOR_SCROLLING : CURSOR_STOPPED);
 	}
 
@@ -23,7 +23,7 @@ Eigen::Vector2f ImageComponent::getCenter() const
 }
 
 ImageComponent::ImageComponent(Window* window) : GuiComponent(window), 
-	mTargetIsMax(false), mFlipX(false), mFlipY(false), mOrigin(0.0, 0.0), mTargetSize(0, 0), mColorShift(0xFFFFFFFF)
+	mTargetSize(0, 0), mOrigin(0.0, 0.0), mFlipX(false), mFlipY(false), mTargetIsMax(false), mMipmap(false), mColorShift(0xFFFFFFFF)
 {
 	updateColors();
 }
@@ -34,6 +34,8 @@ ImageComponent::~ImageComponent()
 
 void ImageComponent::resize()
 {
+	markDirty(); // also covers the texture going away
+
 	if(!mTexture)
 		return;
 
@@ -94,7 +96,10 @@ void ImageComponent::resize()
 	if(svg)
 	{
 		// mSize.y() should already be rounded
-		svg->rasterizeAt((int)round(mSize.x()), (int)round(mSize.y()));
+		// (rasterizations are shared, so this gives us a different texture instead of changing this one)
+		std::shared_ptr<SVGResource> rasterized = svg->getRasterized((int)round(mSize.x()), (int)round(mSize.y()));
+		if(rasterized)
+			mTexture = rasterized;
 	}
 
 	onSizeChanged();
@@ -110,7 +115,7 @@ void ImageComponent::setImage(std::string path, bool tile)
 	if(path.empty() || !ResourceManager::getInstance()->fileExists(path))
 		mTexture.reset();
 	else
-		mTexture = TextureResource::get(path, tile);
+		mTexture = TextureResource::get(path, tile, mMipmap);
 
 	resize();
 }
@@ -119,7 +124,7 @@ void ImageComponent::setImage(const char* path, size_t length, bool tile)
 {
 	mTexture.reset();
 
-	mTexture = TextureResource::get("", tile);
+	mTexture = TextureResource::get("", tile, mMipmap);
 	mTexture->initFromMemory(path, length);
 	
 	resize();
@@ -178,6 +183,8 @@ void ImageComponent::setOpacity(unsigned char opacity)
 
 void ImageComponent::updateVertices()
 {
+	markDirty();
+
 	if(!mTexture || !mTexture->isInitialized())
 		return;
 
@@ -230,16 +237,24 @@ void ImageComponent::updateVertices()
 		for(int i = 1; i < 6; i++)
 			mVertices[i].tex[1] = mVertices[i].tex[1] == py ? 0 : py;
 	}
+
+	// the texture might only be part of an atlas page
+	if(!mTexture->isTiled())
+	{
+		for(int i = 0; i < 6; i++)
+			mVertices[i].tex = mTexture->mapTexCoord(mVertices[i].tex);
+	}
 }
 
 void ImageComponent::updateColors()
 {
-	Renderer::buildGLColorArray(mColors, mColorShift, 6);
+	Renderer::buildVertexColors(mVertices, mColorShift, 6);
+	markDirty();
 }
 
 void ImageComponent::render(const Eigen::Affine3f& parentTrans)
 {
-	Eigen::Affine3f trans = roundMatrix(parentTrans * getTransform());
+	Eigen::Affine3f trans = getWorldTransform(parentTrans, true);
 	Renderer::setMatrix(trans);
 	
 	if(mTexture && mOpacity > 0)
@@ -247,28 +262,7 @@ void ImageComponent::render(const Eigen::Affine3f& parentTrans)
 		if(mTexture->isInitialized())
 		{
 			// actually draw the image
-			mTexture->bind();
-
-			glEnable(GL_TEXTURE_2D);
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-			glEnableClientState(GL_VERTEX_ARRAY);
-			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-			glEnableClientState(GL_COLOR_ARRAY);
-
-			glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &mVertices[0].pos);
-			glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &mVertices[0].tex);
-			glColorPointer(4, GL_UNSIGNED_BYTE, 0, mColors);
-
-			glDrawArrays(GL_TRIANGLES, 0, 6);
-
-			glDisableClientState(GL_VERTEX_ARRAY);
-			glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-			glDisableClientState(GL_COLOR_ARRAY);
-
-			glDisable(GL_TEXTURE_2D);
-			glDisable(GL_BLEND);
+			Renderer::drawTriangles(mVertices, 6, mTexture->getTextureID());
 		}else{
 			LOG(LogError) << "Image texture is not initialized!";
 			mTexture.reset();
@@ -283,10 +277,19 @@ bool ImageComponent::hasImage()
 	return (bool)mTexture;
 }
 
+Eigen::Vector4f ImageComponent::getLocalBounds() const
+{
+	// a pixel of slack for the rounding in updateVertices()
+	return Eigen::Vector4f(floor(-mSize.x() * mOrigin.x()), floor(-mSize.y() * mOrigin.y()),
+		ceil(mSize.x() * (1 - mOrigin.x())) + 1, ceil(mSize.y() * (1 - mOrigin.y())) + 1);
+}
+
 void ImageComponent::applyTheme(const std::shared_ptr<ThemeData>& theme, const std::string& view, const std::string& element, unsigned int properties)
 {
 	using namespace ThemeFlags;
 
+	mThemeElement = element;
+
 	const ThemeData::ThemeElement* elem = theme->getElement(view, element, "image");
 	if(!elem)
 	{
@@ -313,6 +316,10 @@ void ImageComponent::applyTheme(const std::shared_ptr<ThemeData>& theme, const s
 	if((properties & ORIGIN || (properties & POSITION && properties & ThemeFlags::SIZE)) && elem->has("origin"))
 		setOrigin(elem->get<Eigen::Vector2f>("origin"));
 
+	// not tied to a property flag - this also applies to images whose path is set by the view (e.g. md_image)
+	if(elem->has("mipmap"))
+		setMipmap(elem->get<bool>("mipmap"));
+
 	if(properties & PATH && elem->has("path"))
 	{
 		bool tile = (elem->has("tile") && elem->get<bool>("tile"));
@@ -5,6 +5,7 @@
 #include GLHEADER
 
 #include "GuiComponent.h"
+#include "Renderer.h"
 #include <string>
 #include <memory>
 #include "resources/TextureResource.h"
@@ -22,6 +23,9 @@ public:
 	//Use an already existing texture.
 	void setImage(const std::shared_ptr<TextureResource>& texture);
 
+	// Use mipmapped textures for images loaded after this call (for large images drawn small). Also set by the "mipmap" theme property.
+	inline void setMipmap(bool mipmap) { mMipmap = mipmap; }
+
 	void onSizeChanged() override;
 	void setOpacity(unsigned char opacity) override;
 
@@ -57,6 +61,7 @@ public:
 	bool hasImage();
 
 	void render(const Eigen::Affine3f& parentTrans) override;
+	Eigen::Vector4f getLocalBounds() const override; // moved by the origin
 
 	virtual void applyTheme(const std::shared_ptr<ThemeData>& theme, const std::string& view, const std::string& element, unsigned int properties) override;
 
@@ -65,19 +70,13 @@ private:
 	Eigen::Vector2f mTargetSize;
 	Eigen::Vector2f mOrigin;
 
-	bool mFlipX, mFlipY, mTargetIsMax;
+	bool mFlipX, mFlipY, mTargetIsMax, mMipmap;
 
 	// Calculates the correct mSize from our resizing information (set by setResize/setMaxSize).
 	// Used internally whenever the resizing parameters or texture change.
 	void resize();
 
-	struct Vertex
-	{
-		Eigen::Vector2f pos;
-		Eigen::Vector2f tex;
-	} mVertices[6];
-
-	GLubyte mColors[6*4];
+	Renderer::Vertex mVertices[6];
 
 	void updateVertices();
 	void updateColors();
@@ -105,7 +105,8 @@ void ImageGridComponent<T>::add(const std::string& name, const std::string& imag
 	typename IList<ImageGridData, T>::Entry entry;
 	entry.name = name;
 	entry.object = obj;
-	entry.data.texture = ResourceManager::getInstance()->fileExists(imagePath) ? TextureResource::get(imagePath) : TextureResource::get(":/button.png");
+	// thumbnails are always drawn shrunk down into their squares, so they're mipmapped
+	entry.data.texture = ResourceManager::getInstance()->fileExists(imagePath) ? TextureResource::get(imagePath, false, true) : TextureResource::get(":/button.png");
 	static_cast<IList< ImageGridData, T >*>(this)->add(entry);
 	mEntriesDirty = true;
 }
@@ -158,9 +159,11 @@ void ImageGridComponent<T>::render(const Eigen::Affine3f& parentTrans)
 		mEntriesDirty = false;
 	}
 
+	const Eigen::Vector4f clipBounds = Renderer::getClipBounds();
 	for(auto it = mImages.begin(); it != mImages.end(); it++)
 	{
-		it->render(trans);
+		if(!it->cull(trans, clipBounds))
+			it->render(trans);
 	}
 
 	GuiComponent::renderChildren(trans);
@@ -23,6 +23,10 @@ public:
 
 	inline void addRow(const ComponentListRow& row, bool setCursorHere = false) { mList->addRow(row, setCursorHere); updateSize(); }
 
+	// see ComponentList::setDataSource()
+	inline void setDataSource(const std::shared_ptr<ComponentListDataSource>& source, int cursor = 0) { mList->setDataSource(source, cursor); updateSize(); }
+	inline void refreshRows() { mList->refreshRows(); }
+
 	inline void addWithLabel(const std::string& label, const std::shared_ptr<GuiComponent>& comp, bool setCursorHere = false, bool invert_when_selected = true)
 	{
 		ComponentListRow row;
@@ -8,7 +8,7 @@
 NinePatchComponent::NinePatchComponent(Window* window, const std::string& path, unsigned int edgeColor, unsigned int centerColor) : GuiComponent(window),
 	mEdgeColor(edgeColor), mCenterColor(centerColor), 
 	mPath(path),
-	mVertices(NULL), mColors(NULL)
+	mVertices(NULL)
 {
 	if(!mPath.empty())
 		buildVertices();
@@ -18,37 +18,34 @@ NinePatchComponent::~NinePatchComponent()
 {
 	if (mVertices != NULL)
 		delete[] mVertices;
-
-	if (mColors != NULL)
-		delete[] mColors;
 }
 
 void NinePatchComponent::updateColors()
 {
-	Renderer::buildGLColorArray(mColors, mEdgeColor, 6 * 9);
-	Renderer::buildGLColorArray(&mColors[4 * 6 * 4], mCenterColor, 6);
+	markDirty();
+	if(mVertices == NULL)
+		return;
+
+	Renderer::buildVertexColors(mVertices, mEdgeColor, 6 * 9);
+	Renderer::buildVertexColors(&mVertices[4 * 6], mCenterColor, 6);
 }
 
 void NinePatchComponent::buildVertices()
 {
+	markDirty();
 	if(mVertices != NULL)
 		delete[] mVertices;
 
-	if(mColors != NULL)
-		delete[] mColors;
-
 	mTexture = TextureResource::get(mPath);
 
 	if(mTexture->getSize() == Eigen::Vector2i::Zero())
 	{
 		mVertices = NULL;
-		mColors = NULL;
 		LOG(LogWarning) << "NinePatchComponent missing texture!";
 		return;
 	}
 
-	mVertices = new Vertex[6 * 9];
-	mColors = new GLubyte[6 * 9 * 4];
+	mVertices = new Renderer::Vertex[6 * 9];
 	updateColors();
 
 	const Eigen::Vector2f ts = mTexture->getSize().cast<float>();
@@ -129,6 +126,10 @@ void NinePatchComponent::buildVertices()
 		mVertices[v + 4].tex = mVertices[v + 1].tex;
 		mVertices[v + 5].tex = mVertices[v + 0].tex;
 
+		//the texture might only be part of an atlas page
+		for(int i = v; i < v + 6; i++)
+			mVertices[i].tex = mTexture->mapTexCoord(mVertices[i].tex);
+
 		v += 6;
 	}
 
@@ -141,34 +142,12 @@ void NinePatchComponent::buildVertices()
 
 void NinePatchComponent::render(const Eigen::Affine3f& parentTrans)
 {
-	Eigen::Affine3f trans = roundMatrix(parentTrans * getTransform());
+	Eigen::Affine3f trans = getWorldTransform(parentTrans, true);
 	
 	if(mTexture && mVertices != NULL)
 	{
 		Renderer::setMatrix(trans);
-
-		mTexture->bind();
-
-		glEnable(GL_TEXTURE_2D);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glEnableClientState(GL_COLOR_ARRAY);
-
-		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &mVertices[0].pos);
-		glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &mVertices[0].tex);
-		glColorPointer(4, GL_UNSIGNED_BYTE, 0, mColors);
-
-		glDrawArrays(GL_TRIANGLES, 0, 6 * 9);
-
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_COLOR_ARRAY);
-
-		glDisable(GL_TEXTURE_2D);
-		glDisable(GL_BLEND);
+		Renderer::drawTriangles(mVertices, 6 * 9, mTexture->getTextureID());
 	}
 
 	renderChildren(trans);
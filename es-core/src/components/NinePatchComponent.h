@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GuiComponent.h"
+#include "Renderer.h"
 #include "resources/TextureResource.h"
 
 // Display an image in a way so that edges don't get too distorted no matter the final size. Useful for UI elements like backgrounds, buttons, etc.
@@ -38,14 +39,7 @@ private:
 	void buildVertices();
 	void updateColors();
 
-	struct Vertex
-	{
-		Eigen::Vector2f pos;
-		Eigen::Vector2f tex;
-	};
-
-	Vertex* mVertices;
-	GLubyte* mColors;
+	Renderer::Vertex* mVertices;
 
 	std::string mPath;
 	unsigned int mEdgeColor;
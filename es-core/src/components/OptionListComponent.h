@@ -36,80 +36,106 @@ private:
 	class OptionListPopup : public GuiComponent
 	{
 	private:
-		MenuComponent mMenu;
-		OptionListComponent<T>* mParent;
-
-	public:
-		OptionListPopup(Window* window, OptionListComponent<T>* parent, const std::string& title) : GuiComponent(window),
-			mMenu(window, title.c_str()), mParent(parent)
+		// only the options in view get rows, there can be a lot of them (e.g. the systems to scrape)
+		class OptionRows : public ComponentListDataSource
 		{
-			auto font = Font::get(FONT_SIZE_MEDIUM);
-			ComponentListRow row;
+		public:
+			OptionRows(OptionListPopup* popup) : mPopup(popup), mFont(Font::get(FONT_SIZE_MEDIUM)) {}
 
-			// for select all/none
-			std::vector<ImageComponent*> checkboxes;
+			unsigned int getRowCount() override { return mPopup->mParent->mEntries.size(); }
+			float getRowHeight(unsigned int index) override { return mFont->getHeight(); }
 
-			for(auto it = mParent->mEntries.begin(); it != mParent->mEntries.end(); it++)
+			ComponentListRow createRow(unsigned int index) override
 			{
-				row.elements.clear();
-				row.addElement(std::make_shared<TextComponent>(mWindow, strToUpper(it->name), font, 0x777777FF), true);
+				ComponentListRow row;
+				row.addElement(std::make_shared<TextComponent>(mPopup->mWindow, "", mFont, 0x777777FF), true);
 
-				OptionListData& e = *it;
-
-				if(mParent->mMultiSelect)
+				if(mPopup->mParent->mMultiSelect)
 				{
 					// add checkbox
-					auto checkbox = std::make_shared<ImageComponent>(mWindow);
-					checkbox->setImage(it->selected ? CHECKED_PATH : UNCHECKED_PATH);
-					checkbox->setResize(0, font->getLetterHeight());
+					auto checkbox = std::make_shared<ImageComponent>(mPopup->mWindow);
+					checkbox->setResize(0, mFont->getLetterHeight());
 					row.addElement(checkbox, false);
+				}
+
+				bindRow(index, row);
+				return row;
+			}
+
+			bool bindRow(unsigned int index, ComponentListRow& row) override
+			{
+				OptionListPopup* popup = mPopup;
+				OptionListData& e = popup->mParent->mEntries.at(index);
+				std::static_pointer_cast<TextComponent>(row.elements.front().component)->setText(strToUpper(e.name));
+
+				if(popup->mParent->mMultiSelect)
+				{
+					auto checkbox = std::static_pointer_cast<ImageComponent>(row.elements.back().component);
+					checkbox->setImage(e.selected ? CHECKED_PATH : UNCHECKED_PATH);
 
 					// input handler
 					// update checkbox state & selected value
-					row.makeAcceptInputHandler([this, &e, checkbox]
+					row.makeAcceptInputHandler([popup, &e, checkbox]
 					{
 						e.selected = !e.selected;
 						checkbox->setImage(e.selected ? CHECKED_PATH : UNCHECKED_PATH);
-						mParent->onSelectedChanged();
+						popup->mParent->onSelectedChanged();
 					});
-
-					// for select all/none
-					checkboxes.push_back(checkbox.get());
 				}else{
 					// input handler for non-multiselect
 					// update selected value and close
-					row.makeAcceptInputHandler([this, &e]
+					row.makeAcceptInputHandler([popup, &e]
 					{
-						mParent->mEntries.at(mParent->getSelectedId()).selected = false;
+						popup->mParent->mEntries.at(popup->mParent->getSelectedId()).selected = false;
 						e.selected = true;
-						mParent->onSelectedChanged();
-						delete this;
+						popup->mParent->onSelectedChanged();
+						delete popup;
 					});
 				}
 
-				// also set cursor to this row if we're not multi-select and this row is selected
-				mMenu.addRow(row, (!mParent->mMultiSelect && it->selected));
+				return true;
+			}
+
+		private:
+			OptionListPopup* mPopup;
+			std::shared_ptr<Font> mFont;
+		};
+
+		MenuComponent mMenu;
+		OptionListComponent<T>* mParent;
+
+	public:
+		OptionListPopup(Window* window, OptionListComponent<T>* parent, const std::string& title) : GuiComponent(window),
+			mMenu(window, title.c_str()), mParent(parent)
+		{
+			// also set the cursor to the selected row if we're not multi-select
+			int cursor = 0;
+			if(!mParent->mMultiSelect)
+			{
+				for(unsigned int i = 0; i < mParent->mEntries.size(); i++)
+				{
+					if(mParent->mEntries.at(i).selected)
+						cursor = i;
+				}
 			}
 
+			mMenu.setDataSource(std::make_shared<OptionRows>(this), cursor);
+
 			mMenu.addButton("BACK", "accept", [this] { delete this; });
 
 			if(mParent->mMultiSelect)
 			{
-				mMenu.addButton("SELECT ALL", "select all", [this, checkboxes] {
+				mMenu.addButton("SELECT ALL", "select all", [this] {
 					for(unsigned int i = 0; i < mParent->mEntries.size(); i++)
-					{
 						mParent->mEntries.at(i).selected = true;
-						checkboxes.at(i)->setImage(CHECKED_PATH);
-					}
+					mMenu.refreshRows();
 					mParent->onSelectedChanged();
 				});
 
-				mMenu.addButton("SELECT NONE", "select none", [this, checkboxes] {
+				mMenu.addButton("SELECT NONE", "select none", [this] {
 					for(unsigned int i = 0; i < mParent->mEntries.size(); i++)
-					{
 						mParent->mEntries.at(i).selected = false;
-						checkboxes.at(i)->setImage(UNCHECKED_PATH);
-					}
+					mMenu.refreshRows();
 					mParent->onSelectedChanged();
 				});
 			}
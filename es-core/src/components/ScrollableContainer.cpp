@@ -13,7 +13,7 @@ ScrollableContainer::ScrollableContainer(Window* window) : GuiComponent(window),
 
 void ScrollableContainer::render(const Eigen::Affine3f& parentTrans)
 {
-	Eigen::Affine3f trans = parentTrans * getTransform();
+	Eigen::Affine3f trans = getWorldTransform(parentTrans);
 
 	Eigen::Vector2i clipPos((int)trans.translation().x(), (int)trans.translation().y());
 
@@ -54,10 +54,13 @@ Eigen::Vector2f ScrollableContainer::getScrollPos() const
 void ScrollableContainer::setScrollPos(const Eigen::Vector2f& pos)
 {
 	mScrollPos = pos;
+	markDirty();
 }
 
 void ScrollableContainer::update(int deltaTime)
 {
+	const Eigen::Vector2f prevScrollPos = mScrollPos;
+
 	if(mAutoScrollSpeed != 0)
 	{
 		mAutoScrollAccumulator += deltaTime;
@@ -100,6 +103,9 @@ void ScrollableContainer::update(int deltaTime)
 			reset();
 	}
 
+	if(mScrollPos != prevScrollPos)
+		markDirty();
+
 	GuiComponent::update(deltaTime);
 }
 
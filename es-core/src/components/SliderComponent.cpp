@@ -50,6 +50,7 @@ void SliderComponent::update(int deltaTime)
 {
 	if(mMoveRate != 0)
 	{
+		markDirty(); // don't idle while the button is held, the repeat should start on time
 		mMoveAccumulator += deltaTime;
 		while(mMoveAccumulator >= MOVE_REPEAT_RATE)
 		{
@@ -63,7 +64,7 @@ void SliderComponent::update(int deltaTime)
 
 void SliderComponent::render(const Eigen::Affine3f& parentTrans)
 {
-	Eigen::Affine3f trans = roundMatrix(parentTrans * getTransform());
+	Eigen::Affine3f trans = getWorldTransform(parentTrans, true);
 	Renderer::setMatrix(trans);
 
 	// render suffix
@@ -108,6 +109,8 @@ void SliderComponent::onSizeChanged()
 
 void SliderComponent::onValueChanged()
 {
+	markDirty();
+
 	// update suffix textcache
 	if(mFont)
 	{
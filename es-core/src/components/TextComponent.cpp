@@ -71,7 +71,7 @@ void TextComponent::setUppercase(bool uppercase)
 
 void TextComponent::render(const Eigen::Affine3f& parentTrans)
 {
-	Eigen::Affine3f trans = parentTrans * getTransform();
+	Eigen::Affine3f trans = getWorldTransform(parentTrans);
 
 	/*Eigen::Vector3f dim(mSize.x(), mSize.y(), 0);
 	dim = trans * dim - trans.translation();
@@ -133,6 +133,7 @@ void TextComponent::calculateExtent()
 
 void TextComponent::onTextChanged()
 {
+	markDirty();
 	calculateExtent();
 
 	if(!mFont || mText.empty())
@@ -178,6 +179,7 @@ void TextComponent::onTextChanged()
 
 void TextComponent::onColorChanged()
 {
+	markDirty();
 	if(mTextCache)
 	{
 		mTextCache->setColor(mColor);
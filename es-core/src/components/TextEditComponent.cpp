@@ -156,6 +156,7 @@ void TextEditComponent::updateCursorRepeat(int deltaTime)
 	if(mCursorRepeatDir == 0)
 		return;
 
+	markDirty(); // don't idle while the button is held, the repeat should start on time
 	mCursorRepeatTimer += deltaTime;
 	while(mCursorRepeatTimer >= CURSOR_REPEAT_SPEED)
 	{
@@ -182,6 +183,7 @@ void TextEditComponent::setCursor(size_t pos)
 
 void TextEditComponent::onTextChanged()
 {
+	markDirty();
 	std::string wrappedText = (isMultiline() ? mFont->wrapText(mText, getTextAreaSize().x()) : mText);
 	mTextCache = std::unique_ptr<TextCache>(mFont->buildTextCache(wrappedText, 0, 0, 0x77777700 | getOpacity()));
 
@@ -191,6 +193,7 @@ void TextEditComponent::onTextChanged()
 
 void TextEditComponent::onCursorChanged()
 {
+	markDirty();
 	if(isMultiline())
 	{
 		Eigen::Vector2f textSize = mFont->getWrappedTextCursorOffset(mText, getTextAreaSize().x(), mCursor); 
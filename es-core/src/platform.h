@@ -1,9 +1,14 @@
 //the Makefile defines one of these:
 //#define USE_OPENGL_ES
 //#define USE_OPENGL_DESKTOP
+//and USE_OPENGL_SHADERS for the shader pipeline (GLES 2.0 / OpenGL 2.1) instead of the fixed function one
 
 #ifdef USE_OPENGL_ES
-	#define GLHEADER <GLES/gl.h>
+	#ifdef USE_OPENGL_SHADERS
+		#define GLHEADER <GLES2/gl2.h>
+	#else
+		#define GLHEADER <GLES/gl.h>
+	#endif
 #endif
 
 #ifdef USE_OPENGL_DESKTOP
@@ -1,18 +1,144 @@
 #include "resources/Font.h"
 #include <iostream>
+#include <sstream>
 #include <algorithm>
 #include <vector>
+#include <string.h>
 #include <boost/filesystem.hpp>
 #include "Renderer.h"
 #include "Log.h"
 #include "Util.h"
+#include "Settings.h"
+#include "ThreadPool.h"
+#include <SDL.h>
+
+#define FACE_IDLE_TIMEOUT 30000 // how long (in ms) a font keeps its font files open after loading its last glyph
+#define INITIAL_TEXTURE_SIZE 256
+#define MAX_TEXTURE_SIZE 4096 // whatever the driver allows, a full texture is also kept in RAM
+#define SDF_GLYPH_SIZE 48 // SDF glyphs are made from glyphs of this size, and scaled to the font's size when drawn
+#define SDF_SPREAD 6 // how far (in pixels at SDF_GLYPH_SIZE) distances reach beyond a glyph's edges
+#define MAX_SHAPED_GLYPHS 16384 // per shape cache generation, about 256KB
 
 FT_Library Font::sLibrary = NULL;
 
 int Font::getSize() const { return mSize; }
 
 std::map< std::pair<std::string, int>, std::weak_ptr<Font> > Font::sFontMap;
+std::map< std::string, std::weak_ptr<Font::FontFace> > Font::sFaceMap;
+std::map< std::pair<std::string, bool>, std::weak_ptr<Font::FontTextureList> > Font::sTextureMap;
+std::map< std::string, std::weak_ptr<Font::SDFGlyphs> > Font::sSDFMap;
+
+static int getMaxTextureSize()
+{
+	static GLint maxSize = 0;
+	if(maxSize <= 0)
+	{
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+		if(maxSize <= 0 || maxSize > MAX_TEXTURE_SIZE)
+			maxSize = MAX_TEXTURE_SIZE;
+	}
+
+	return maxSize;
+}
+
+// Squared euclidean distance transform of one row or column (Felzenszwalb & Huttenlocher), f is replaced by the result.
+// v, z and d are scratch space for at least n, n + 1 and n values.
+static void distanceTransform(float* f, size_t stride, int n, int* v, float* z, float* d)
+{
+	const float inf = 1e20f;
+
+	int k = 0;
+	v[0] = 0;
+	z[0] = -inf;
+	z[1] = inf;
+
+	for(int q = 1; q < n; q++)
+	{
+		// where the parabola from q starts to be lower than the lowest one so far (z[0] is low enough to always stop at it)
+		float s = ((f[q * stride] + q * q) - (f[v[k] * stride] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+		while(s <= z[k])
+		{
+			k--;
+			s = ((f[q * stride] + q * q) - (f[v[k] * stride] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+		}
 
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = inf;
+	}
+
+	k = 0;
+	for(int q = 0; q < n; q++)
+	{
+		while(z[k + 1] < q)
+			k++;
+		d[q] = (q - v[k]) * (q - v[k]) + f[v[k] * stride];
+	}
+
+	for(int q = 0; q < n; q++)
+		f[q * stride] = d[q];
+}
+
+static void distanceTransform(std::vector<float>& grid, int width, int height)
+{
+	const int n = std::max(width, height);
+	std::vector<int> v(n);
+	std::vector<float> z(n + 1);
+	std::vector<float> d(n);
+
+	for(int x = 0; x < width; x++)
+		distanceTransform(grid.data() + x, width, height, v.data(), z.data(), d.data());
+	for(int y = 0; y < height; y++)
+		distanceTransform(grid.data() + y * width, 1, width, v.data(), z.data(), d.data());
+}
+
+// Turns a glyph's coverage into a signed distance field with SDF_SPREAD pixels of padding on every side.
+// The edge ends up at 128, partially covered pixels move it by a fraction of a pixel (the same trick Mapbox's TinySDF uses).
+// Runs on ThreadPool workers.
+static std::vector<unsigned char> buildSDF(const std::vector<unsigned char>& coverage, int width, int height)
+{
+	const float inf = 1e20f;
+	const int sdfWidth = width + SDF_SPREAD * 2;
+	const int sdfHeight = height + SDF_SPREAD * 2;
+
+	// squared distances to the nearest pixel inside and outside the glyph
+	std::vector<float> toInside(sdfWidth * sdfHeight, inf);
+	std::vector<float> toOutside(sdfWidth * sdfHeight, 0.0f);
+
+	for(int y = 0; y < height; y++)
+	{
+		for(int x = 0; x < width; x++)
+		{
+			const float a = coverage[y * width + x] / 255.0f;
+			const int i = (y + SDF_SPREAD) * sdfWidth + x + SDF_SPREAD;
+
+			if(a >= 1.0f)
+			{
+				toInside[i] = 0.0f;
+				toOutside[i] = inf;
+			}else if(a > 0.0f)
+			{
+				const float d = 0.5f - a;
+				toInside[i] = d > 0 ? d * d : 0.0f;
+				toOutside[i] = d < 0 ? d * d : 0.0f;
+			}
+		}
+	}
+
+	distanceTransform(toInside, sdfWidth, sdfHeight);
+	distanceTransform(toOutside, sdfWidth, sdfHeight);
+
+	std::vector<unsigned char> sdf(sdfWidth * sdfHeight);
+	for(unsigned int i = 0; i < sdf.size(); i++)
+	{
+		const float distance = sqrtf(toInside[i]) - sqrtf(toOutside[i]); // positive outside the glyph
+		const float value = 255.0f - 255.0f * (distance / SDF_SPREAD + 0.5f);
+		sdf[i] = (unsigned char)std::max(0.0f, std::min(255.0f, value + 0.5f));
+	}
+
+	return sdf;
+}
 
 // utf8 stuff
 size_t Font::getNextCursor(const std::string& str, size_t cursor)
@@ -137,12 +263,10 @@ UnicodeChar Font::readUnicodeChar(const std::string& str, size_t& cursor)
 }
 
 
-Font::FontFace::FontFace(ResourceData&& d, int size) : data(d)
+Font::FontFace::FontFace(ResourceData&& d) : data(d)
 {
 	int err = FT_New_Memory_Face(sLibrary, data.ptr.get(), data.length, 0, &face);
 	assert(!err);
-	
-	FT_Set_Pixel_Sizes(face, 0, size);
 }
 
 Font::FontFace::~FontFace()
@@ -151,6 +275,37 @@ Font::FontFace::~FontFace()
 		FT_Done_Face(face);
 }
 
+std::shared_ptr<Font::FontFace> Font::FontFace::get(const std::string& path)
+{
+	auto found = sFaceMap.find(path);
+	if(found != sFaceMap.end() && !found->second.expired())
+		return found->second.lock();
+
+	ResourceData data = ResourceManager::getInstance()->getFileData(path);
+	std::shared_ptr<FontFace> face(new FontFace(std::move(data)));
+	sFaceMap[path] = face;
+	return face;
+}
+
+Font::FontFaceSize::FontFaceSize(const std::shared_ptr<FontFace>& f, int pixelSize) : face(f)
+{
+	FT_New_Size(face->face, &size);
+	FT_Activate_Size(size);
+	FT_Set_Pixel_Sizes(face->face, 0, pixelSize);
+}
+
+Font::FontFaceSize::~FontFaceSize()
+{
+	FT_Done_Size(size);
+}
+
+void Font::FontFaceSize::activate()
+{
+	// other sizes of the same font may have activated theirs since
+	if(face->face->size != size)
+		FT_Activate_Size(size);
+}
+
 void Font::initLibrary()
 {
 	assert(sLibrary == NULL);
@@ -164,11 +319,8 @@ void Font::initLibrary()
 size_t Font::getMemUsage() const
 {
 	size_t memUsage = 0;
-	for(auto it = mTextures.begin(); it != mTextures.end(); it++)
-		memUsage += it->textureSize.x() * it->textureSize.y() * 4;
-
-	for(auto it = mFaceCache.begin(); it != mFaceCache.end(); it++)
-		memUsage += it->second->data.length;
+	for(auto it = mTextures->begin(); it != mTextures->end(); it++)
+		memUsage += (*it)->textureSize.x() * (*it)->textureSize.y(); // 8-bit alpha
 
 	return memUsage;
 }
@@ -186,32 +338,132 @@ size_t Font::getTotalMemUsage()
 			continue;
 		}
 
-		total += it->second.lock()->getMemUsage();
 		it++;
 	}
 
+	// textures are shared between sizes, so count them once per font file
+	auto texIt = sTextureMap.begin();
+	while(texIt != sTextureMap.end())
+	{
+		std::shared_ptr<FontTextureList> textures = texIt->second.lock();
+		if(!textures)
+		{
+			texIt = sTextureMap.erase(texIt);
+			continue;
+		}
+
+		for(auto tex = textures->begin(); tex != textures->end(); tex++)
+			total += (*tex)->textureSize.x() * (*tex)->textureSize.y();
+		texIt++;
+	}
+
+	// font files are shared between sizes, so count each one once
+	auto faceIt = sFaceMap.begin();
+	while(faceIt != sFaceMap.end())
+	{
+		if(faceIt->second.expired())
+		{
+			faceIt = sFaceMap.erase(faceIt);
+			continue;
+		}
+
+		total += faceIt->second.lock()->data.length;
+		faceIt++;
+	}
+
 	return total;
 }
 
-Font::Font(int size, const std::string& path) : mSize(size), mPath(path)
+std::string Font::getAtlasUsage()
+{
+	std::stringstream ss;
+
+	for(auto it = sTextureMap.begin(); it != sTextureMap.end(); it++)
+	{
+		std::shared_ptr<FontTextureList> textures = it->second.lock();
+		if(!textures)
+			continue;
+
+		if(!ss.str().empty())
+			ss << "\n";
+
+		ss << boost::filesystem::path(it->first.first).filename().string() << (it->first.second ? " (SDF):" : ":");
+		for(auto tex = textures->begin(); tex != textures->end(); tex++)
+		{
+			ss << " " << (*tex)->textureSize.x() << "x" << (*tex)->textureSize.y() << " ("
+				<< (100 * (*tex)->usedArea / ((*tex)->textureSize.x() * (*tex)->textureSize.y())) << "%)";
+		}
+
+		// sizes sharing these textures
+		ss << ", sizes";
+		for(auto font = sFontMap.begin(); font != sFontMap.end(); font++)
+		{
+			std::shared_ptr<Font> f = font->second.lock();
+			if(f && font->first.first == it->first.first && (f->mSDFGlyphs != nullptr) == it->first.second)
+				ss << " " << font->first.second;
+		}
+	}
+
+	return ss.str();
+}
+
+void Font::releaseIdleFaces()
+{
+	const unsigned int now = SDL_GetTicks();
+
+	for(auto it = sFontMap.begin(); it != sFontMap.end(); it++)
+	{
+		std::shared_ptr<Font> font = it->second.lock();
+		if(font && !font->mFaceCache.empty() && now - font->mLastFaceUse > FACE_IDLE_TIMEOUT)
+			font->clearFaceCache();
+	}
+}
+
+Font::Font(int size, const std::string& path) : mLastFaceUse(0), mSize(size), mPath(path)
 {
 	assert(mSize > 0);
 	
 	mMaxGlyphHeight = 0;
+	mShapeCacheGlyphs = 0;
+	mKerning = Settings::getInstance()->getBool("FontKerning");
+	std::fill(mGlyphTable, mGlyphTable + GLYPH_TABLE_SIZE, (Glyph*)NULL);
 
 	if(!sLibrary)
 		initLibrary();
 
+	if(Settings::getInstance()->getBool("FontSDF") && Renderer::hasShader(Renderer::SHADER_SDF))
+	{
+		// one set of glyphs for every size
+		auto foundGlyphs = sSDFMap.find(mPath);
+		if(foundGlyphs != sSDFMap.end() && !foundGlyphs->second.expired())
+		{
+			mSDFGlyphs = foundGlyphs->second.lock();
+		}else{
+			mSDFGlyphs = std::make_shared<SDFGlyphs>();
+			sSDFMap[mPath] = mSDFGlyphs;
+		}
+
+		mTextures = std::shared_ptr<FontTextureList>(mSDFGlyphs, &mSDFGlyphs->textures);
+		sTextureMap[std::make_pair(mPath, true)] = mTextures;
+	}else{
+		auto foundTextures = sTextureMap.find(std::make_pair(mPath, false));
+		if(foundTextures != sTextureMap.end() && !foundTextures->second.expired())
+		{
+			mTextures = foundTextures->second.lock();
+		}else{
+			mTextures = std::make_shared<FontTextureList>();
+			sTextureMap[std::make_pair(mPath, false)] = mTextures;
+		}
+	}
+
 	// always initialize ASCII characters
 	for(UnicodeChar i = 32; i < 128; i++)
 		getGlyph(i);
-
-	clearFaceCache();
 }
 
 Font::~Font()
 {
-	unload(ResourceManager::getInstance());
+	// our textures are deleted along with the last size of this font that uses them
 }
 
 void Font::reload(std::shared_ptr<ResourceManager>& rm)
@@ -244,18 +496,20 @@ std::shared_ptr<Font> Font::get(int size, const std::string& path)
 
 void Font::unloadTextures()
 {
-	for(auto it = mTextures.begin(); it != mTextures.end(); it++)
+	for(auto it = mTextures->begin(); it != mTextures->end(); it++)
 	{
-		it->deinitTexture();
+		(*it)->deinitTexture();
 	}
 }
 
-Font::FontTexture::FontTexture()
+Font::FontTexture::FontTexture(bool sdf) : sdf(sdf)
 {
 	textureId = 0;
-	textureSize << 2048, 512;
-	writePos = Eigen::Vector2i::Zero();
-	rowHeight = 0;
+	textureSize << INITIAL_TEXTURE_SIZE, INITIAL_TEXTURE_SIZE;
+	usedArea = 0;
+
+	SkylineNode node = { 0, 0, textureSize.x() };
+	skyline.push_back(node);
 }
 
 Font::FontTexture::~FontTexture()
@@ -265,30 +519,119 @@ Font::FontTexture::~FontTexture()
 
 bool Font::FontTexture::findEmpty(const Eigen::Vector2i& size, Eigen::Vector2i& cursor_out)
 {
-	if(size.x() >= textureSize.x() || size.y() >= textureSize.y())
-		return false;
+	const Eigen::Vector2i paddedSize(size.x() + 1, size.y() + 1); // leave 1px of space between glyphs
 
-	if(writePos.x() + size.x() >= textureSize.x() &&
-		writePos.y() + rowHeight + size.y() + 1 < textureSize.y())
+	while(true)
 	{
-		// row full, but it should fit on the next row
-		// move cursor to next row
-		writePos << 0, writePos.y() + rowHeight + 1; // leave 1px of space between glyphs
-		rowHeight = 0;
+		// bottom-left: take the spot where the glyph's bottom edge ends up lowest (then the narrowest one)
+		int bestNode = -1;
+		int bestY = 0;
+		for(unsigned int i = 0; i < skyline.size(); i++)
+		{
+			const int y = fitSkyline(i, paddedSize);
+			if(y >= 0 && (bestNode == -1 || y < bestY || (y == bestY && skyline[i].width < skyline[bestNode].width)))
+			{
+				bestNode = i;
+				bestY = y;
+			}
+		}
+
+		if(bestNode != -1)
+		{
+			const SkylineNode node = { skyline[bestNode].x, bestY + paddedSize.y(), paddedSize.x() };
+			skyline.insert(skyline.begin() + bestNode, node);
+
+			// cut the nodes the glyph now covers
+			for(unsigned int i = bestNode + 1; i < skyline.size(); )
+			{
+				const int overlap = node.x + node.width - skyline[i].x;
+				if(overlap <= 0)
+					break;
+
+				if(overlap < skyline[i].width)
+				{
+					skyline[i].x += overlap;
+					skyline[i].width -= overlap;
+					break;
+				}
+
+				skyline.erase(skyline.begin() + i);
+			}
+
+			// merge neighbours at the same height
+			for(unsigned int i = 0; i + 1 < skyline.size(); )
+			{
+				if(skyline[i].y == skyline[i + 1].y)
+				{
+					skyline[i].width += skyline[i + 1].width;
+					skyline.erase(skyline.begin() + i + 1);
+				}else{
+					i++;
+				}
+			}
+
+			cursor_out << node.x, bestY;
+			usedArea += paddedSize.x() * paddedSize.y();
+			return true;
+		}
+
+		if(!grow())
+			return false;
 	}
+}
+
+int Font::FontTexture::fitSkyline(size_t node, const Eigen::Vector2i& size) const
+{
+	if(skyline[node].x + size.x() > textureSize.x())
+		return -1;
 
-	if(writePos.x() + size.x() >= textureSize.x() ||
-		writePos.y() + size.y() >= textureSize.y())
+	int y = 0;
+	int widthLeft = size.x();
+	for(size_t i = node; widthLeft > 0; i++)
 	{
-		// nope, still won't fit
+		y = std::max(y, skyline[i].y);
+		if(y + size.y() > textureSize.y())
+			return -1;
+
+		widthLeft -= skyline[i].width;
+	}
+
+	return y;
+}
+
+bool Font::FontTexture::grow()
+{
+	const int maxSize = getMaxTextureSize();
+
+	// keep it roughly square
+	Eigen::Vector2i newSize = textureSize;
+	if(textureSize.x() <= textureSize.y() && textureSize.x() * 2 <= maxSize)
+		newSize[0] *= 2;
+	else if(textureSize.y() * 2 <= maxSize)
+		newSize[1] *= 2;
+	else
 		return false;
+
+	std::vector<unsigned char> newPixels(newSize.x() * newSize.y(), 0);
+	for(int y = 0; y < textureSize.y(); y++)
+		memcpy(newPixels.data() + y * newSize.x(), pixels.data() + y * textureSize.x(), textureSize.x());
+
+	if(newSize.x() > textureSize.x())
+	{
+		SkylineNode node = { textureSize.x(), 0, newSize.x() - textureSize.x() };
+		skyline.push_back(node);
 	}
 
-	cursor_out = writePos;
-	writePos[0] += size.x() + 1; // leave 1px of space between glyphs
+	textureSize = newSize;
+	pixels.swap(newPixels);
 
-	if(size.y() > rowHeight)
-		rowHeight = size.y();
+	// glyphs keep their texel positions, TextCaches made for the old size fix their texture coordinates when they're drawn
+	if(textureId != 0)
+	{
+		Renderer::flush(); // queued up draws still use the old texture coordinates
+		Renderer::bindTexture(textureId);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, textureSize.x(), textureSize.y(), 0, GL_ALPHA, GL_UNSIGNED_BYTE, pixels.data());
+	}
 
 	return true;
 }
@@ -298,35 +641,79 @@ void Font::FontTexture::initTexture()
 	assert(textureId == 0);
 
 	glGenTextures(1, &textureId);
-	glBindTexture(GL_TEXTURE_2D, textureId);
+	Renderer::bindTexture(textureId);
 
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	// distance fields are meant to be interpolated
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sdf ? GL_LINEAR : GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sdf ? GL_LINEAR : GL_NEAREST);
 
 	glPixelStorei(GL_PACK_ALIGNMENT, 1);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, textureSize.x(), textureSize.y(), 0, GL_ALPHA, GL_UNSIGNED_BYTE, NULL);
+	if(pixels.empty())
+		pixels.resize(textureSize.x() * textureSize.y(), 0);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, textureSize.x(), textureSize.y(), 0, GL_ALPHA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+void Font::FontTexture::writeGlyph(const Eigen::Vector2i& pos, const FT_Bitmap& bitmap)
+{
+	for(unsigned int y = 0; y < bitmap.rows; y++)
+		memcpy(pixels.data() + (pos.y() + y) * textureSize.x() + pos.x(), bitmap.buffer + y * bitmap.pitch, bitmap.width);
+
+	// FreeType may pad its rows, GL (without GL_UNPACK_ROW_LENGTH on GLES) expects them packed
+	std::vector<unsigned char> packed;
+	const unsigned char* data = bitmap.buffer;
+	if(bitmap.pitch != (int)bitmap.width)
+	{
+		packed.resize(bitmap.width * bitmap.rows);
+		for(unsigned int y = 0; y < bitmap.rows; y++)
+			memcpy(packed.data() + y * bitmap.width, bitmap.buffer + y * bitmap.pitch, bitmap.width);
+		data = packed.data();
+	}
+
+	Renderer::bindTexture(textureId);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, pos.x(), pos.y(), bitmap.width, bitmap.rows, GL_ALPHA, GL_UNSIGNED_BYTE, data);
+}
+
+void Font::FontTexture::writePixels(const Eigen::Vector2i& pos, const Eigen::Vector2i& size, const unsigned char* data)
+{
+	for(int y = 0; y < size.y(); y++)
+		memcpy(pixels.data() + (pos.y() + y) * textureSize.x() + pos.x(), data + y * size.x(), size.x());
+
+	Renderer::bindTexture(textureId);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, pos.x(), pos.y(), size.x(), size.y(), GL_ALPHA, GL_UNSIGNED_BYTE, data);
+}
+
+void Font::FontTexture::uploadPendingGlyphs()
+{
+	for(auto it = pendingGlyphs.begin(); it != pendingGlyphs.end(); it++)
+	{
+		const std::vector<unsigned char> data = it->data.get();
+		writePixels(it->pos, it->size, data.data());
+	}
+
+	pendingGlyphs.clear();
 }
 
 void Font::FontTexture::deinitTexture()
 {
 	if(textureId != 0)
 	{
-		glDeleteTextures(1, &textureId);
+		Renderer::deleteTexture(textureId);
 		textureId = 0;
 	}
 }
 
 void Font::getTextureForNewGlyph(const Eigen::Vector2i& glyphSize, FontTexture*& tex_out, Eigen::Vector2i& cursor_out)
 {
-	if(mTextures.size())
+	// full textures have already grown as much as they can, so only the most recent one might have space
+	if(mTextures->size())
 	{
-		// check if the most recent texture has space
-		tex_out = &mTextures.back();
+		tex_out = mTextures->back().get();
 
 		// will this one work?
 		if(tex_out->findEmpty(glyphSize, cursor_out))
@@ -335,8 +722,8 @@ void Font::getTextureForNewGlyph(const Eigen::Vector2i& glyphSize, FontTexture*&
 
 	// current textures are full,
 	// make a new one
-	mTextures.push_back(FontTexture());
-	tex_out = &mTextures.back();
+	mTextures->push_back(std::unique_ptr<FontTexture>(new FontTexture(mSDFGlyphs != nullptr)));
+	tex_out = mTextures->back().get();
 	tex_out->initTexture();
 	
 	bool ok = tex_out->findEmpty(glyphSize, cursor_out);
@@ -400,31 +787,45 @@ std::vector<std::string> getFallbackFontPaths()
 #endif
 }
 
-FT_Face Font::getFaceForChar(UnicodeChar id)
+Font::FontFaceSize* Font::getFaceSize(unsigned int faceIndex)
 {
 	static const std::vector<std::string> fallbackFonts = getFallbackFontPaths();
 
-	// look through our current font + fallback fonts to see if any have the glyph we're looking for
-	for(unsigned int i = 0; i < fallbackFonts.size() + 1; i++)
+	mLastFaceUse = SDL_GetTicks();
+
+	auto fit = mFaceCache.find(faceIndex);
+	if(fit == mFaceCache.end()) // doesn't exist yet
 	{
-		auto fit = mFaceCache.find(i);
+		// faceIndex == 0 -> mPath
+		// otherwise, take from fallbackFonts
+		const std::string& path = (faceIndex == 0 ? mPath : fallbackFonts.at(faceIndex - 1));
+		fit = mFaceCache.insert(std::make_pair(faceIndex, std::unique_ptr<FontFaceSize>(new FontFaceSize(FontFace::get(path), getRasterSize())))).first;
+	}
+
+	return fit->second.get();
+}
+
+FT_Face Font::getFaceForChar(UnicodeChar id, unsigned int& faceIndex_out)
+{
+	static const size_t faceCount = getFallbackFontPaths().size() + 1;
 
-		if(fit == mFaceCache.end()) // doesn't exist yet
+	// look through our current font + fallback fonts to see if any have the glyph we're looking for
+	for(unsigned int i = 0; i < faceCount; i++)
+	{
+		FontFaceSize* faceSize = getFaceSize(i);
+		if(FT_Get_Char_Index(faceSize->face->face, id) != 0)
 		{
-			// i == 0 -> mPath
-			// otherwise, take from fallbackFonts
-			const std::string& path = (i == 0 ? mPath : fallbackFonts.at(i - 1));
-			ResourceData data = ResourceManager::getInstance()->getFileData(path);
-			mFaceCache[i] = std::unique_ptr<FontFace>(new FontFace(std::move(data), mSize));
-			fit = mFaceCache.find(i);
+			faceSize->activate();
+			faceIndex_out = i;
+			return faceSize->face->face;
 		}
-
-		if(FT_Get_Char_Index(fit->second->face, id) != 0)
-			return fit->second->face;
 	}
 
 	// nothing has a valid glyph - return the "real" face so we get a "missing" character
-	return mFaceCache.begin()->second->face;
+	FontFaceSize* faceSize = getFaceSize(0);
+	faceSize->activate();
+	faceIndex_out = 0;
+	return faceSize->face->face;
 }
 
 void Font::clearFaceCache()
@@ -432,15 +833,33 @@ void Font::clearFaceCache()
 	mFaceCache.clear();
 }
 
-Font::Glyph* Font::getGlyph(UnicodeChar id)
+int Font::getRasterSize() const
+{
+	return mSDFGlyphs ? SDF_GLYPH_SIZE : mSize;
+}
+
+Font::Glyph* Font::loadGlyph(UnicodeChar id)
 {
 	// is it already loaded?
+	Glyph* glyph;
 	auto it = mGlyphMap.find(id);
 	if(it != mGlyphMap.end())
-		return &it->second;
+		glyph = &it->second;
+	else
+		glyph = mSDFGlyphs ? getSDFGlyph(id) : createGlyph(id);
+
+	// map nodes never move, so the table can point into it
+	if(glyph && id < GLYPH_TABLE_SIZE)
+		mGlyphTable[id] = glyph;
 
+	return glyph;
+}
+
+Font::Glyph* Font::createGlyph(UnicodeChar id)
+{
 	// nope, need to make a glyph
-	FT_Face face = getFaceForChar(id);
+	unsigned int faceIndex;
+	FT_Face face = getFaceForChar(id, faceIndex);
 	if(!face)
 	{
 		LOG(LogError) << "Could not find appropriate font face for character " << id << " for font " << mPath;
@@ -472,16 +891,20 @@ Font::Glyph* Font::getGlyph(UnicodeChar id)
 	Glyph& glyph = mGlyphMap[id];
 	
 	glyph.texture = tex;
-	glyph.texPos << cursor.x() / (float)tex->textureSize.x(), cursor.y() / (float)tex->textureSize.y();
-	glyph.texSize << glyphSize.x() / (float)tex->textureSize.x(), glyphSize.y() / (float)tex->textureSize.y();
+	glyph.texPos = cursor;
+	glyph.texSize = glyphSize;
+	glyph.size = glyphSize.cast<float>();
+	glyph.padding = 0.0f;
 
 	glyph.advance << (float)g->metrics.horiAdvance / 64.0f, (float)g->metrics.vertAdvance / 64.0f;
 	glyph.bearing << (float)g->metrics.horiBearingX / 64.0f, (float)g->metrics.horiBearingY / 64.0f;
 
-	// upload glyph bitmap to texture
-	glBindTexture(GL_TEXTURE_2D, tex->textureId);
-	glTexSubImage2D(GL_TEXTURE_2D, 0, cursor.x(), cursor.y(), glyphSize.x(), glyphSize.y(), GL_ALPHA, GL_UNSIGNED_BYTE, g->bitmap.buffer);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	glyph.faceIndex = faceIndex;
+	glyph.charIndex = g->glyph_index;
+	glyph.kerned = FT_HAS_KERNING(face) != 0;
+
+	// copy glyph bitmap to texture
+	tex->writeGlyph(cursor, g->bitmap);
 
 	// update max glyph height
 	if(glyphSize.y() > mMaxGlyphHeight)
@@ -491,36 +914,190 @@ Font::Glyph* Font::getGlyph(UnicodeChar id)
 	return &glyph;
 }
 
-// completely recreate the texture data for all textures based on mGlyphs information
-void Font::rebuildTextures()
+Font::Glyph* Font::getSDFGlyph(UnicodeChar id)
 {
-	// recreate OpenGL textures
-	for(auto it = mTextures.begin(); it != mTextures.end(); it++)
+	auto found = mSDFGlyphs->glyphs.find(id);
+	if(found == mSDFGlyphs->glyphs.end())
 	{
-		it->initTexture();
+		// another size hasn't made this one yet
+		unsigned int faceIndex;
+		FT_Face face = getFaceForChar(id, faceIndex);
+		if(!face)
+		{
+			LOG(LogError) << "Could not find appropriate font face for character " << id << " for font " << mPath;
+			return NULL;
+		}
+
+		FT_GlyphSlot g = face->glyph;
+
+		if(FT_Load_Char(face, id, FT_LOAD_RENDER))
+		{
+			LOG(LogError) << "Could not find glyph for character " << id << " for font " << mPath << " (SDF)!";
+			return NULL;
+		}
+
+		const Eigen::Vector2i glyphSize(g->bitmap.width, g->bitmap.rows);
+		const Eigen::Vector2i sdfSize(glyphSize.x() + SDF_SPREAD * 2, glyphSize.y() + SDF_SPREAD * 2);
+
+		FontTexture* tex = NULL;
+		Eigen::Vector2i cursor;
+		getTextureForNewGlyph(sdfSize, tex, cursor);
+		if(tex == NULL)
+		{
+			LOG(LogError) << "Could not create glyph for character " << id << " for font " << mPath << " (SDF, no suitable texture found)!";
+			return NULL;
+		}
+
+		// the distance field is made on a worker, and written to the texture before it's drawn
+		std::vector<unsigned char> coverage(glyphSize.x() * glyphSize.y());
+		for(int y = 0; y < glyphSize.y(); y++)
+			memcpy(coverage.data() + y * glyphSize.x(), g->bitmap.buffer + y * g->bitmap.pitch, glyphSize.x());
+
+		FontTexture::PendingGlyph pending;
+		pending.pos = cursor;
+		pending.size = sdfSize;
+		pending.data = ThreadPool::getInstance()->queue(std::bind(&buildSDF, std::move(coverage), glyphSize.x(), glyphSize.y()));
+		tex->pendingGlyphs.push_back(std::move(pending));
+
+		Glyph& glyph = mSDFGlyphs->glyphs[id];
+		glyph.texture = tex;
+		glyph.texPos = cursor;
+		glyph.texSize = sdfSize;
+		glyph.size = glyphSize.cast<float>();
+		glyph.padding = SDF_SPREAD;
+		glyph.advance << (float)g->metrics.horiAdvance / 64.0f, (float)g->metrics.vertAdvance / 64.0f;
+		glyph.bearing << (float)g->metrics.horiBearingX / 64.0f, (float)g->metrics.horiBearingY / 64.0f;
+		glyph.faceIndex = faceIndex; // every size of a font has the same faces in the same order
+		glyph.charIndex = g->glyph_index;
+		glyph.kerned = FT_HAS_KERNING(face) != 0;
+
+		found = mSDFGlyphs->glyphs.find(id);
 	}
 
-	// reupload the texture data
-	for(auto it = mGlyphMap.begin(); it != mGlyphMap.end(); it++)
+	// scale it to our size
+	const float scale = (float)mSize / SDF_GLYPH_SIZE;
+
+	Glyph& glyph = mGlyphMap[id];
+	glyph = found->second;
+	glyph.size *= scale;
+	glyph.padding *= scale;
+	glyph.advance *= scale;
+	glyph.bearing *= scale;
+
+	// update max glyph height
+	if((int)round(glyph.size.y()) > mMaxGlyphHeight)
+		mMaxGlyphHeight = (int)round(glyph.size.y());
+
+	return &glyph;
+}
+
+float Font::loadKerning(const Glyph* left, const Glyph* right)
+{
+	const unsigned long long key = ((unsigned long long)left->faceIndex << 48) | ((unsigned long long)left->charIndex << 24) | right->charIndex;
+	auto found = mKerningCache.find(key);
+	if(found != mKerningCache.end())
+		return found->second;
+
+	FontFaceSize* faceSize = getFaceSize(left->faceIndex);
+	faceSize->activate();
+
+	FT_Vector delta;
+	float kerning = 0.0f;
+	if(FT_Get_Kerning(faceSize->face->face, left->charIndex, right->charIndex, FT_KERNING_UNFITTED, &delta) == 0)
+		kerning = (delta.x / 64.0f) * mSize / getRasterSize();
+
+	mKerningCache[key] = kerning;
+	return kerning;
+}
+
+std::shared_ptr<const Font::ShapedText> Font::shapeText(const std::string& text)
+{
+	auto found = mShapeCache.find(text);
+	if(found != mShapeCache.end())
+		return found->second;
+
+	std::shared_ptr<const ShapedText> shaped;
+
+	found = mOldShapeCache.find(text);
+	if(found != mOldShapeCache.end())
 	{
-		FT_Face face = getFaceForChar(it->first);
-		FT_GlyphSlot glyphSlot = face->glyph;
+		shaped = found->second;
+		mOldShapeCache.erase(found);
+	}else{
+		std::shared_ptr<ShapedText> newShaped = std::make_shared<ShapedText>();
+		newShaped->glyphs.reserve(text.length() + 1);
+		newShaped->lineCount = 1;
+		newShaped->width = 0.0f;
+
+		const ShapedText::ShapedGlyph lineStart = { NULL, 0.0f };
+		newShaped->glyphs.push_back(lineStart);
+		size_t lineStartIndex = 0; // its width is filled in when the line ends
+
+		float lineWidth = 0.0f;
+		const Glyph* prevGlyph = NULL;
+
+		size_t cursor = 0;
+		while(cursor < text.length())
+		{
+			UnicodeChar character = readUnicodeChar(text, cursor); // advances cursor
 
-		// load the glyph bitmap through FT
-		FT_Load_Char(face, it->first, FT_LOAD_RENDER);
+			// invalid character
+			if(character == 0)
+				continue;
 
-		FontTexture* tex = it->second.texture;
-		
-		// find the position/size
-		Eigen::Vector2i cursor(it->second.texPos.x() * tex->textureSize.x(), it->second.texPos.y() * tex->textureSize.y());
-		Eigen::Vector2i glyphSize(it->second.texSize.x() * tex->textureSize.x(), it->second.texSize.y() * tex->textureSize.y());
-		
-		// upload to texture
-		glBindTexture(GL_TEXTURE_2D, tex->textureId);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, cursor.x(), cursor.y(), glyphSize.x(), glyphSize.y(), GL_ALPHA, GL_UNSIGNED_BYTE, glyphSlot->bitmap.buffer);
+			if(character == (UnicodeChar)'\n')
+			{
+				newShaped->glyphs[lineStartIndex].x = lineWidth;
+				newShaped->width = std::max(newShaped->width, lineWidth);
+
+				lineStartIndex = newShaped->glyphs.size();
+				newShaped->glyphs.push_back(lineStart);
+				newShaped->lineCount++;
+
+				lineWidth = 0.0f;
+				prevGlyph = NULL;
+				continue;
+			}
+
+			const Glyph* glyph = getGlyph(character);
+			if(glyph == NULL)
+				continue;
+
+			lineWidth += getKerning(prevGlyph, glyph);
+
+			ShapedText::ShapedGlyph shapedGlyph = { glyph, lineWidth };
+			newShaped->glyphs.push_back(shapedGlyph);
+
+			lineWidth += glyph->advance.x();
+			prevGlyph = glyph;
+		}
+
+		newShaped->glyphs[lineStartIndex].x = lineWidth;
+		newShaped->width = std::max(newShaped->width, lineWidth);
+		shaped = newShaped;
 	}
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+	if(mShapeCacheGlyphs + shaped->glyphs.size() > MAX_SHAPED_GLYPHS)
+	{
+		mOldShapeCache.swap(mShapeCache);
+		mShapeCache.clear();
+		mShapeCacheGlyphs = 0;
+	}
+
+	mShapeCache[text] = shaped;
+	mShapeCacheGlyphs += shaped->glyphs.size();
+	return shaped;
+}
+
+// recreate the textures from their CPU copies
+void Font::rebuildTextures()
+{
+	for(auto it = mTextures->begin(); it != mTextures->end(); it++)
+	{
+		// other sizes of this font may have done it already
+		if((*it)->textureId == 0)
+			(*it)->initTexture();
+	}
 }
 
 void Font::renderTextCache(TextCache* cache)
@@ -533,35 +1110,28 @@ void Font::renderTextCache(TextCache* cache)
 
 	for(auto it = cache->vertexLists.begin(); it != cache->vertexLists.end(); it++)
 	{
-		assert(*it->textureIdPtr != 0);
+		assert(it->texture->textureId != 0);
 
-		auto vertexList = *it;
+		it->texture->uploadPendingGlyphs();
 
-		glBindTexture(GL_TEXTURE_2D, *it->textureIdPtr);
-		glEnable(GL_TEXTURE_2D);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glEnableClientState(GL_COLOR_ARRAY);
-
-		glVertexPointer(2, GL_FLOAT, sizeof(TextCache::Vertex), it->verts[0].pos.data());
-		glTexCoordPointer(2, GL_FLOAT, sizeof(TextCache::Vertex), it->verts[0].tex.data());
-		glColorPointer(4, GL_UNSIGNED_BYTE, 0, it->colors.data());
-
-		glDrawArrays(GL_TRIANGLES, 0, it->verts.size());
+		// the texture grew since the cache was built, glyphs kept their texel positions
+		if(it->textureSize != it->texture->textureSize)
+		{
+			const Eigen::Vector2f scale = it->textureSize.cast<float>().cwiseQuotient(it->texture->textureSize.cast<float>());
+			for(auto vert = it->verts.begin(); vert != it->verts.end(); vert++)
+				vert->tex = vert->tex.cwiseProduct(scale);
 
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_COLOR_ARRAY);
+			it->textureSize = it->texture->textureSize;
+		}
 
-		glDisable(GL_TEXTURE_2D);
-		glDisable(GL_BLEND);
+		const Renderer::Shader shader = it->texture->sdf ? Renderer::SHADER_SDF : Renderer::SHADER_ALPHA_TEXTURE;
+		Renderer::drawTriangles(it->verts.data(), it->verts.size(), it->texture->textureId, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, shader);
 	}
 }
 
-Eigen::Vector2f Font::sizeText(std::string text, float lineSpacing)
+// measures the way shapeText lays out, but without going through the shape cache
+// (layout measures lots of strings that are never drawn, they'd allocate and push the drawn ones out of the cache)
+Eigen::Vector2f Font::sizeText(const std::string& text, float lineSpacing)
 {
 	float lineWidth = 0.0f;
 	float highestWidth = 0.0f;
@@ -570,23 +1140,34 @@ Eigen::Vector2f Font::sizeText(std::string text, float lineSpacing)
 
 	float y = lineHeight;
 
+	const Glyph* prevGlyph = NULL;
+
 	size_t i = 0;
 	while(i < text.length())
 	{
 		UnicodeChar character = readUnicodeChar(text, i); // advances i
 
+		// invalid character
+		if(character == 0)
+			continue;
+
 		if(character == (UnicodeChar)'\n')
 		{
 			if(lineWidth > highestWidth)
 				highestWidth = lineWidth;
 
 			lineWidth = 0.0f;
+			prevGlyph = NULL;
 			y += lineHeight;
+			continue;
 		}
 
-		Glyph* glyph = getGlyph(character);
+		const Glyph* glyph = getGlyph(character);
 		if(glyph)
-			lineWidth += glyph->advance.x();
+		{
+			lineWidth += getKerning(prevGlyph, glyph) + glyph->advance.x();
+			prevGlyph = glyph;
+		}
 	}
 
 	if(lineWidth > highestWidth)
@@ -604,92 +1185,176 @@ float Font::getLetterHeight()
 {
 	Glyph* glyph = getGlyph((UnicodeChar)'S');
 	assert(glyph);
-	return glyph->texSize.y() * glyph->texture->textureSize.y();
+	return glyph->size.y();
 }
 
-//the worst algorithm ever written
-//breaks up a normal string with newlines to make it fit xLen
-std::string Font::wrapText(std::string text, float xLen)
+// finds where wrapText would insert newlines, in a single pass over text
+// words keep their trailing whitespace, and a word that doesn't fit on the current line moves to the next one
+// (a single word wider than xLen still gets a line of its own)
+std::vector<size_t> Font::getWrapBreaks(const std::string& text, float xLen)
 {
-	std::string out;
+	std::vector<size_t> breaks;
 
-	std::string line, word, temp;
-	size_t space;
+	float lineWidth = 0.0f;
+	float wordStartWidth = 0.0f; // lineWidth at wordStart
+	size_t lineStart = 0;
+	size_t wordStart = 0;
 
-	Eigen::Vector2f textSize;
+	Glyph* prevGlyph = NULL;
 
-	while(text.length() > 0) //while there's text or we still have text to render
+	size_t cursor = 0;
+	while(cursor < text.length())
 	{
-		space = text.find_first_of(" \t\n");
-		if(space == std::string::npos)
-			space = text.length() - 1;
+		UnicodeChar character = readUnicodeChar(text, cursor); // advances cursor
 
-		word = text.substr(0, space + 1);
-		text.erase(0, space + 1);
+		if(character == (UnicodeChar)'\n')
+		{
+			lineWidth = 0.0f;
+			prevGlyph = NULL;
+			wordStartWidth = 0.0f;
+			lineStart = cursor;
+			wordStart = cursor;
+			continue;
+		}
 
-		temp = line + word;
+		Glyph* glyph = getGlyph(character);
+		if(glyph)
+		{
+			lineWidth += getKerning(prevGlyph, glyph) + glyph->advance.x();
+			prevGlyph = glyph;
+		}
 
-		textSize = sizeText(temp);
+		// the word (and its trailing whitespace) won't fit, move it to a new line
+		if(lineWidth > xLen && wordStart != lineStart)
+		{
+			breaks.push_back(wordStart);
+			lineWidth -= wordStartWidth;
+			lineStart = wordStart;
+		}
 
-		// if the word will fit on the line, add it to our line, and continue
-		if(textSize.x() <= xLen)
+		if(character == (UnicodeChar)' ' || character == (UnicodeChar)'\t')
 		{
-			line = temp;
-			continue;
-		}else{
-			// the next word won't fit, so break here
-			out += line + '\n';
-			line = word;
+			wordStart = cursor;
+			wordStartWidth = lineWidth;
 		}
 	}
 
-	// whatever's left should fit
-	out += line;
+	return breaks;
+}
+
+// breaks up a normal string with newlines to make it fit xLen
+std::string Font::wrapText(const std::string& text, float xLen)
+{
+	const std::vector<size_t> breaks = getWrapBreaks(text, xLen);
+
+	std::string out;
+	out.reserve(text.length() + breaks.size());
+
+	size_t lineStart = 0;
+	for(auto it = breaks.begin(); it != breaks.end(); it++)
+	{
+		out.append(text, lineStart, *it - lineStart);
+		out += '\n';
+		lineStart = *it;
+	}
+	out.append(text, lineStart, std::string::npos);
 
 	return out;
 }
 
-Eigen::Vector2f Font::sizeWrappedText(std::string text, float xLen, float lineSpacing)
+Eigen::Vector2f Font::sizeWrappedText(const std::string& text, float xLen, float lineSpacing)
 {
-	text = wrapText(text, xLen);
-	return sizeText(text, lineSpacing);
+	const std::vector<size_t> breaks = getWrapBreaks(text, xLen);
+	auto nextBreak = breaks.begin();
+
+	float lineWidth = 0.0f;
+	float highestWidth = 0.0f;
+
+	const float lineHeight = getHeight(lineSpacing);
+
+	float y = lineHeight;
+
+	Glyph* prevGlyph = NULL;
+
+	size_t cursor = 0;
+	while(cursor < text.length())
+	{
+		if(nextBreak != breaks.end() && *nextBreak == cursor)
+		{
+			if(lineWidth > highestWidth)
+				highestWidth = lineWidth;
+
+			lineWidth = 0.0f;
+			prevGlyph = NULL;
+			y += lineHeight;
+			nextBreak++;
+		}
+
+		UnicodeChar character = readUnicodeChar(text, cursor); // advances cursor
+
+		if(character == (UnicodeChar)'\n')
+		{
+			if(lineWidth > highestWidth)
+				highestWidth = lineWidth;
+
+			lineWidth = 0.0f;
+			prevGlyph = NULL;
+			y += lineHeight;
+			continue;
+		}
+
+		Glyph* glyph = getGlyph(character);
+		if(glyph)
+		{
+			lineWidth += getKerning(prevGlyph, glyph) + glyph->advance.x();
+			prevGlyph = glyph;
+		}
+	}
+
+	if(lineWidth > highestWidth)
+		highestWidth = lineWidth;
+
+	return Eigen::Vector2f(highestWidth, y);
 }
 
-Eigen::Vector2f Font::getWrappedTextCursorOffset(std::string text, float xLen, size_t stop, float lineSpacing)
+Eigen::Vector2f Font::getWrappedTextCursorOffset(const std::string& text, float xLen, size_t stop, float lineSpacing)
 {
-	std::string wrappedText = wrapText(text, xLen);
+	const std::vector<size_t> breaks = getWrapBreaks(text, xLen);
+	auto nextBreak = breaks.begin();
 
 	float lineWidth = 0.0f;
 	float y = 0.0f;
 
-	size_t wrapCursor = 0;
+	Glyph* prevGlyph = NULL;
+
 	size_t cursor = 0;
 	while(cursor < stop)
 	{
-		UnicodeChar wrappedCharacter = readUnicodeChar(wrappedText, wrapCursor);
-		UnicodeChar character = readUnicodeChar(text, cursor);
-
-		if(wrappedCharacter == (UnicodeChar)'\n' && character != (UnicodeChar)'\n')
+		if(nextBreak != breaks.end() && *nextBreak == cursor)
 		{
-			//this is where the wordwrap inserted a newline
-			//reset lineWidth and increment y, but don't consume a cursor character
+			//this is where the wordwrap inserts a newline
 			lineWidth = 0.0f;
+			prevGlyph = NULL;
 			y += getHeight(lineSpacing);
-
-			cursor = getPrevCursor(text, cursor); // unconsume
-			continue;
+			nextBreak++;
 		}
 
+		UnicodeChar character = readUnicodeChar(text, cursor);
+
 		if(character == (UnicodeChar)'\n')
 		{
 			lineWidth = 0.0f;
+			prevGlyph = NULL;
 			y += getHeight(lineSpacing);
 			continue;
 		}
 
 		Glyph* glyph = getGlyph(character);
 		if(glyph)
-			lineWidth += glyph->advance.x();
+		{
+			lineWidth += getKerning(prevGlyph, glyph) + glyph->advance.x();
+			prevGlyph = glyph;
+		}
 	}
 
 	return Eigen::Vector2f(lineWidth, y);
@@ -699,22 +1364,18 @@ Eigen::Vector2f Font::getWrappedTextCursorOffset(std::string text, float xLen, s
 //TextCache
 //=============================================================================================================
 
-float Font::getNewlineStartOffset(const std::string& text, const unsigned int& charStart, const float& xLen, const Alignment& alignment)
+// where a line of lineWidth starts when aligned in xLen (xLen == 0 means no alignment)
+static float getLineStartOffset(float lineWidth, float xLen, Alignment alignment)
 {
+	if(xLen == 0)
+		return 0;
+
 	switch(alignment)
 	{
-	case ALIGN_LEFT:
-		return 0;
 	case ALIGN_CENTER:
-		{
-			unsigned int endChar = text.find('\n', charStart);
-			return (xLen - sizeText(text.substr(charStart, endChar != std::string::npos ? endChar - charStart : endChar)).x()) / 2.0f;
-		}
+		return (xLen - lineWidth) / 2.0f;
 	case ALIGN_RIGHT:
-		{
-			unsigned int endChar = text.find('\n', charStart);
-			return xLen - (sizeText(text.substr(charStart, endChar != std::string::npos ? endChar - charStart : endChar)).x());
-		}
+		return xLen - lineWidth;
 	default:
 		return 0;
 	}
@@ -727,56 +1388,56 @@ inline float font_round(float v)
 
 TextCache* Font::buildTextCache(const std::string& text, Eigen::Vector2f offset, unsigned int color, float xLen, Alignment alignment, float lineSpacing)
 {
-	float x = offset[0] + (xLen != 0 ? getNewlineStartOffset(text, 0, xLen, alignment) : 0);
-	
+	std::shared_ptr<const ShapedText> shaped = shapeText(text);
+	float lineStart = 0.0f;
+
 	float yTop = getGlyph((UnicodeChar)'S')->bearing.y();
 	float yBot = getHeight(lineSpacing);
 	float y = offset[1] + (yBot + yTop)/2.0f;
 
-	// vertices by texture
-	std::map< FontTexture*, std::vector<TextCache::Vertex> > vertMap;
+	TextCache* cache = new TextCache();
 
-	size_t cursor = 0;
-	UnicodeChar character;
-	Glyph* glyph;
-	while(cursor < text.length())
+	for(auto shapedGlyph = shaped->glyphs.begin(); shapedGlyph != shaped->glyphs.end(); shapedGlyph++)
 	{
-		character = readUnicodeChar(text, cursor); // also advances cursor
+		const Glyph* glyph = shapedGlyph->glyph;
+		if(glyph == NULL)
+		{
+			// a new line, which knows its width for alignment
+			if(shapedGlyph != shaped->glyphs.begin())
+				y += getHeight(lineSpacing);
 
-		// invalid character
-		if(character == 0)
+			lineStart = offset[0] + getLineStartOffset(shapedGlyph->x, xLen, alignment);
 			continue;
+		}
 
-		if(character == (UnicodeChar)'\n')
+		const float x = lineStart + shapedGlyph->x;
+
+		// vertices by texture, there's rarely more than one or two
+		auto vertList = cache->vertexLists.begin();
+		while(vertList != cache->vertexLists.end() && vertList->texture != glyph->texture)
+			vertList++;
+		if(vertList == cache->vertexLists.end())
 		{
-			y += getHeight(lineSpacing);
-			x = offset[0] + (xLen != 0 ? getNewlineStartOffset(text, cursor /* cursor is already advanced */, xLen, alignment) : 0);
-			continue;
+			cache->vertexLists.push_back(TextCache::takeVertexList(glyph->texture));
+			vertList = cache->vertexLists.end() - 1;
 		}
 
-		glyph = getGlyph(character);
-		if(glyph == NULL)
-			continue;
-
-		std::vector<TextCache::Vertex>& verts = vertMap[glyph->texture];
+		std::vector<Renderer::Vertex>& verts = vertList->verts;
 		size_t oldVertSize = verts.size();
 		verts.resize(oldVertSize + 6);
-		TextCache::Vertex* tri = verts.data() + oldVertSize;
-
-		const float glyphStartX = x + glyph->bearing.x();
+		Renderer::Vertex* tri = verts.data() + oldVertSize;
 
-		const Eigen::Vector2i& textureSize = glyph->texture->textureSize;
+		const float glyphStartX = x + glyph->bearing.x() - glyph->padding;
+		const float glyphStartY = y - glyph->bearing.y() - glyph->padding;
+		const Eigen::Vector2f quadSize(glyph->size.x() + glyph->padding * 2, glyph->size.y() + glyph->padding * 2);
 
 		// triangle 1
 		// round to fix some weird "cut off" text bugs
-		tri[0].pos << font_round(glyphStartX), font_round(y + (glyph->texSize.y() * textureSize.y() - glyph->bearing.y()));
-		tri[1].pos << font_round(glyphStartX + glyph->texSize.x() * textureSize.x()), font_round(y - glyph->bearing.y());
+		tri[0].pos << font_round(glyphStartX), font_round(glyphStartY + quadSize.y());
+		tri[1].pos << font_round(glyphStartX + quadSize.x()), font_round(glyphStartY);
 		tri[2].pos << tri[0].pos.x(), tri[1].pos.y();
 
-		//tri[0].tex << 0, 0;
-		//tri[0].tex << 1, 1;
-		//tri[0].tex << 0, 1;
-
+		// in texels for now, a later glyph might still make the texture grow
 		tri[0].tex << glyph->texPos.x(), glyph->texPos.y() + glyph->texSize.y();
 		tri[1].tex << glyph->texPos.x() + glyph->texSize.x(), glyph->texPos.y();
 		tri[2].tex << tri[0].tex.x(), tri[1].tex.y();
@@ -789,31 +1450,21 @@ TextCache* Font::buildTextCache(const std::string& text, Eigen::Vector2f offset,
 		tri[3].tex = tri[0].tex;
 		tri[4].tex = tri[1].tex;
 		tri[5].tex << tri[1].tex.x(), tri[0].tex.y();
-
-		// advance
-		x += glyph->advance.x();
 	}
 
-	//TextCache::CacheMetrics metrics = { sizeText(text, lineSpacing) };
-
-	TextCache* cache = new TextCache();
-	cache->vertexLists.resize(vertMap.size());
-	cache->metrics = { sizeText(text, lineSpacing) };
+	cache->metrics = { Eigen::Vector2f(shaped->width, getHeight(lineSpacing) * shaped->lineCount) };
 
-	unsigned int i = 0;
-	for(auto it = vertMap.begin(); it != vertMap.end(); it++)
+	for(auto vertList = cache->vertexLists.begin(); vertList != cache->vertexLists.end(); vertList++)
 	{
-		TextCache::VertexList& vertList = cache->vertexLists.at(i);
+		vertList->textureSize = vertList->texture->textureSize;
 
-		vertList.textureIdPtr = &it->first->textureId;
-		vertList.verts = it->second;
+		const Eigen::Vector2f texelSize(1.0f / vertList->textureSize.x(), 1.0f / vertList->textureSize.y());
+		for(auto vert = vertList->verts.begin(); vert != vertList->verts.end(); vert++)
+			vert->tex = vert->tex.cwiseProduct(texelSize);
 
-		vertList.colors.resize(4 * it->second.size());
-		Renderer::buildGLColorArray(vertList.colors.data(), color, it->second.size());
+		Renderer::buildVertexColors(vertList->verts.data(), color, vertList->verts.size());
 	}
 
-	clearFaceCache();
-
 	return cache;
 }
 
@@ -822,10 +1473,34 @@ TextCache* Font::buildTextCache(const std::string& text, float offsetX, float of
 	return buildTextCache(text, Eigen::Vector2f(offsetX, offsetY), color, 0.0f);
 }
 
+#define MAX_POOLED_VERTEX_LISTS 256
+
+std::vector<TextCache::VertexList> TextCache::sVertexListPool;
+
+TextCache::~TextCache()
+{
+	for(auto it = vertexLists.begin(); it != vertexLists.end() && sVertexListPool.size() < MAX_POOLED_VERTEX_LISTS; it++)
+		sVertexListPool.push_back(std::move(*it));
+}
+
+TextCache::VertexList TextCache::takeVertexList(Font::FontTexture* texture)
+{
+	VertexList list;
+	if(!sVertexListPool.empty())
+	{
+		list = std::move(sVertexListPool.back());
+		sVertexListPool.pop_back();
+		list.verts.clear();
+	}
+
+	list.texture = texture;
+	return list;
+}
+
 void TextCache::setColor(unsigned int color)
 {
 	for(auto it = vertexLists.begin(); it != vertexLists.end(); it++)
-		Renderer::buildGLColorArray(it->colors.data(), color, it->verts.size());
+		Renderer::buildVertexColors(it->verts.data(), color, it->verts.size());
 }
 
 std::shared_ptr<Font> Font::getFromTheme(const ThemeData::ThemeElement* elem, unsigned int properties, const std::shared_ptr<Font>& orig)
@@ -1,11 +1,16 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <future>
 #include "platform.h"
 #include GLHEADER
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_SIZES_H
 #include <Eigen/Dense>
+#include "Renderer.h"
 #include "resources/ResourceManager.h"
 #include "ThemeData.h"
 
@@ -38,14 +43,15 @@ public:
 
 	virtual ~Font();
 
-	Eigen::Vector2f sizeText(std::string text, float lineSpacing = 1.5f); // Returns the expected size of a string when rendered.  Extra spacing is applied to the Y axis.
+	Eigen::Vector2f sizeText(const std::string& text, float lineSpacing = 1.5f); // Returns the expected size of a string when rendered.  Extra spacing is applied to the Y axis.
 	TextCache* buildTextCache(const std::string& text, float offsetX, float offsetY, unsigned int color);
 	TextCache* buildTextCache(const std::string& text, Eigen::Vector2f offset, unsigned int color, float xLen, Alignment alignment = ALIGN_LEFT, float lineSpacing = 1.5f);
 	void renderTextCache(TextCache* cache);
 	
-	std::string wrapText(std::string text, float xLen); // Inserts newlines into text to make it wrap properly.
-	Eigen::Vector2f sizeWrappedText(std::string text, float xLen, float lineSpacing = 1.5f); // Returns the expected size of a string after wrapping is applied.
-	Eigen::Vector2f getWrappedTextCursorOffset(std::string text, float xLen, size_t cursor, float lineSpacing = 1.5f); // Returns the position of of the cursor after moving "cursor" characters.
+	std::string wrapText(const std::string& text, float xLen); // Inserts newlines into text to make it wrap properly.
+	Eigen::Vector2f sizeWrappedText(const std::string& text, float xLen, float lineSpacing = 1.5f); // Returns the expected size of a string after wrapping is applied.
+	Eigen::Vector2f getWrappedTextCursorOffset(const std::string& text, float xLen, size_t cursor, float lineSpacing = 1.5f); // Returns the position of of the cursor after moving "cursor" characters.
+	std::vector<size_t> getWrapBreaks(const std::string& text, float xLen); // Returns the offsets in text where wrapText inserts a newline.
 
 	float getHeight(float lineSpacing = 1.5f) const;
 	float getLetterHeight();
@@ -60,8 +66,11 @@ public:
 
 	static std::shared_ptr<Font> getFromTheme(const ThemeData::ThemeElement* elem, unsigned int properties, const std::shared_ptr<Font>& orig);
 
-	size_t getMemUsage() const; // returns an approximation of VRAM used by this font's texture (in bytes)
-	static size_t getTotalMemUsage(); // returns an approximation of total VRAM used by font textures (in bytes)
+	size_t getMemUsage() const; // returns an approximation of VRAM used by this font's textures, which are shared with the other sizes of this font (in bytes)
+	static size_t getTotalMemUsage(); // returns an approximation of total VRAM used by font textures, plus the memory used by open font files (in bytes)
+	static std::string getAtlasUsage(); // describes the glyph textures of every loaded font file and how full they are, one line per file
+
+	static void releaseIdleFaces(); // closes the font files of fonts that haven't loaded a glyph in a while, called periodically by Window
 
 	// utf8 stuff
 	static size_t getNextCursor(const std::string& str, size_t cursor);
@@ -75,64 +84,179 @@ private:
 
 	Font(int size, const std::string& path);
 
+	// A glyph texture, shared by every size of the same font file.
+	// It starts small and doubles in size (up to the driver's maximum) when it runs out of space.
 	struct FontTexture
 	{
 		GLuint textureId;
 		Eigen::Vector2i textureSize;
-
-		Eigen::Vector2i writePos;
-		int rowHeight;
-
-		FontTexture();
+		std::vector<unsigned char> pixels; // CPU copy of the texture (8-bit alpha), so it can be restored with a single upload
+		size_t usedArea; // texels taken by glyphs, including the space between them
+		const bool sdf; // holds signed distance fields instead of coverage, filtered linearly and drawn with the SDF shader
+
+		struct PendingGlyph
+		{
+			Eigen::Vector2i pos;
+			Eigen::Vector2i size;
+			std::future< std::vector<unsigned char> > data;
+		};
+		std::vector<PendingGlyph> pendingGlyphs; // glyphs still being made on a worker thread
+
+		struct SkylineNode
+		{
+			int x;
+			int y;
+			int width;
+		};
+		std::vector<SkylineNode> skyline; // the top edge of the glyphs packed so far, from left to right
+
+		FontTexture(bool sdf);
 		~FontTexture();
-		bool findEmpty(const Eigen::Vector2i& size, Eigen::Vector2i& cursor_out);
+		bool findEmpty(const Eigen::Vector2i& size, Eigen::Vector2i& cursor_out); // finds a spot for a glyph, growing the texture if needed
+		int fitSkyline(size_t node, const Eigen::Vector2i& size) const; // returns the y a glyph would be placed at with its left edge at node, or -1 if it doesn't fit there
+		bool grow(); // doubles the texture's width or height, returns false if it's already as big as it gets
 
 		// you must call initTexture() after creating a FontTexture to get a textureId
-		void initTexture(); // initializes the OpenGL texture according to this FontTexture's settings, updating textureId
+		void initTexture(); // initializes the OpenGL texture according to this FontTexture's settings and uploads pixels, updating textureId
+		void writeGlyph(const Eigen::Vector2i& pos, const FT_Bitmap& bitmap); // copies a rendered glyph into pixels and the texture
+		void writePixels(const Eigen::Vector2i& pos, const Eigen::Vector2i& size, const unsigned char* data); // same, for packed 8-bit alpha
+		void uploadPendingGlyphs(); // waits for pendingGlyphs and writes them
 		void deinitTexture(); // deinitializes the OpenGL texture if any exists, is automatically called in the destructor
 	};
 
+	typedef std::vector< std::unique_ptr<FontTexture> > FontTextureList;
+
+	// a font file opened by FreeType, shared by every size of that font
 	struct FontFace
 	{
 		const ResourceData data;
 		FT_Face face;
 
-		FontFace(ResourceData&& d, int size);
+		FontFace(ResourceData&& d);
 		virtual ~FontFace();
+
+		static std::shared_ptr<FontFace> get(const std::string& path); // opens path, or returns the face another font already has open
 	};
 
-	void rebuildTextures();
-	void unloadTextures();
+	// one font size on a shared face, activate() before loading glyphs from face
+	struct FontFaceSize
+	{
+		const std::shared_ptr<FontFace> face;
+		FT_Size size;
 
-	std::vector<FontTexture> mTextures;
+		FontFaceSize(const std::shared_ptr<FontFace>& f, int pixelSize);
+		~FontFaceSize();
 
-	void getTextureForNewGlyph(const Eigen::Vector2i& glyphSize, FontTexture*& tex_out, Eigen::Vector2i& cursor_out);
+		void activate();
+	};
 
-	std::map< unsigned int, std::unique_ptr<FontFace> > mFaceCache;
-	FT_Face getFaceForChar(UnicodeChar id);
-	void clearFaceCache();
+	static std::map< std::string, std::weak_ptr<FontFace> > sFaceMap;
 
 	struct Glyph
 	{
 		FontTexture* texture;
 		
-		Eigen::Vector2f texPos;
-		Eigen::Vector2f texSize; // in texels!
+		// in texels, the texture might grow after the glyph was added
+		Eigen::Vector2i texPos;
+		Eigen::Vector2i texSize;
+
+		Eigen::Vector2f size; // in pixels, can differ from texSize for SDF glyphs
+		float padding; // the quad extends this many pixels beyond size on every side (the SDF's spread)
 
 		Eigen::Vector2f advance;
 		Eigen::Vector2f bearing;
+
+		unsigned int faceIndex; // the mFaceCache face it was loaded from
+		FT_UInt charIndex; // its index in that face
+		bool kerned; // that face has kerning pairs
+	};
+
+	// One set of signed distance field glyphs, drawn at every size of a font (if the FontSDF setting is on).
+	struct SDFGlyphs
+	{
+		FontTextureList textures;
+		std::map<UnicodeChar, Glyph> glyphs; // at SDF_GLYPH_SIZE, Fonts scale them to their size
 	};
 
+	std::shared_ptr<SDFGlyphs> mSDFGlyphs; // NULL when drawing bitmap glyphs
+	static std::map< std::string, std::weak_ptr<SDFGlyphs> > sSDFMap;
+
+	Glyph* getSDFGlyph(UnicodeChar id);
+	int getRasterSize() const; // the size glyphs are loaded from FreeType at
+
+	void rebuildTextures();
+	void unloadTextures();
+
+	std::shared_ptr<FontTextureList> mTextures; // shared with the other sizes of this font
+	static std::map< std::pair<std::string, bool>, std::weak_ptr<FontTextureList> > sTextureMap; // (path, SDF)
+
+	void getTextureForNewGlyph(const Eigen::Vector2i& glyphSize, FontTexture*& tex_out, Eigen::Vector2i& cursor_out);
+
+	std::map< unsigned int, std::unique_ptr<FontFaceSize> > mFaceCache; // 0 is mPath, the others are fallback fonts
+	unsigned int mLastFaceUse; // SDL_GetTicks() of the last getFaceSize call
+	FontFaceSize* getFaceSize(unsigned int faceIndex); // opens the face if it isn't open (anymore)
+	FT_Face getFaceForChar(UnicodeChar id, unsigned int& faceIndex_out);
+	void clearFaceCache();
+
 	std::map<UnicodeChar, Glyph> mGlyphMap;
 
-	Glyph* getGlyph(UnicodeChar id);
+	// glyphs for code points below this (ASCII, Latin-1 and Latin Extended-A/B) are found without searching mGlyphMap
+	static const UnicodeChar GLYPH_TABLE_SIZE = 0x250;
+	Glyph* mGlyphTable[GLYPH_TABLE_SIZE]; // points into mGlyphMap, NULL if not loaded yet
+
+	// doesn't allocate for glyphs that are already loaded, so neither does measuring text that has been measured before
+	inline Glyph* getGlyph(UnicodeChar id)
+	{
+		if(id < GLYPH_TABLE_SIZE && mGlyphTable[id] != NULL)
+			return mGlyphTable[id];
+
+		return loadGlyph(id);
+	}
+
+	Glyph* loadGlyph(UnicodeChar id); // finds the glyph in mGlyphMap, or creates it
+	Glyph* createGlyph(UnicodeChar id);
+
+	// extra space between two glyphs (usually negative), free for faces without kerning pairs
+	// opt-in (the FontKerning setting), it changes the width of text that themes were laid out with
+	inline float getKerning(const Glyph* left, const Glyph* right)
+	{
+		if(!mKerning || left == NULL || !left->kerned || left->faceIndex != right->faceIndex)
+			return 0.0f;
+
+		return loadKerning(left, right);
+	}
+
+	float loadKerning(const Glyph* left, const Glyph* right); // finds the pair in mKerningCache, or asks FreeType
+	std::unordered_map<unsigned long long, float> mKerningCache; // by face index and both char indices
+	bool mKerning; // the FontKerning setting when we were made
+
+	// a string's glyphs, positioned on their lines
+	struct ShapedText
+	{
+		struct ShapedGlyph
+		{
+			const Glyph* glyph; // NULL for the start of a line
+			float x; // from the start of its line, or the width of the line for a line start
+		};
+
+		std::vector<ShapedGlyph> glyphs; // starts with a line start, so aligning a line never needs to look ahead
+		unsigned int lineCount;
+		float width; // of the widest line
+	};
+
+	// Shapes text for buildTextCache, or returns the result from the last time it was shaped (measuring doesn't use it).
+	// Recently shaped strings are kept in two generations: when mShapeCache is full it replaces mOldShapeCache, and strings used again move back.
+	std::shared_ptr<const ShapedText> shapeText(const std::string& text);
+	typedef std::unordered_map< std::string, std::shared_ptr<const ShapedText> > ShapeCache;
+	ShapeCache mShapeCache;
+	ShapeCache mOldShapeCache;
+	size_t mShapeCacheGlyphs; // glyphs in mShapeCache
 
 	int mMaxGlyphHeight;
 	
 	const int mSize;
 	const std::string mPath;
 
-	float getNewlineStartOffset(const std::string& text, const unsigned int& charStart, const float& xLen, const Alignment& alignment);
 
 	friend TextCache;
 };
@@ -144,22 +268,22 @@ private:
 class TextCache
 {
 protected:
-	struct Vertex
-	{
-		Eigen::Vector2f pos;
-		Eigen::Vector2f tex;
-	};
-
 	struct VertexList
 	{
-		GLuint* textureIdPtr; // this is a pointer because the texture ID can change during deinit/reinit (when launching a game)
-		std::vector<Vertex> verts;
-		std::vector<GLubyte> colors;
+		Font::FontTexture* texture; // the texture ID can change during deinit/reinit (when launching a game), and the texture can grow
+		Eigen::Vector2i textureSize; // texture size the texture coordinates were made for
+		std::vector<Renderer::Vertex> verts;
 	};
 
 	std::vector<VertexList> vertexLists;
 
+	// Buffers of destroyed caches are kept (up to a limit) and handed to new ones, so building a cache rarely allocates.
+	static VertexList takeVertexList(Font::FontTexture* texture);
+	static std::vector<VertexList> sVertexListPool;
+
 public:
+	~TextCache();
+
 	struct CacheMetrics
 	{
 		Eigen::Vector2f size;
@@ -0,0 +1,70 @@
+#include "resources/RenderTarget.h"
+#include "Renderer.h"
+
+size_t RenderTarget::sTotalMemUsage = 0;
+
+std::shared_ptr<RenderTarget> RenderTarget::create()
+{
+	std::shared_ptr<RenderTarget> target(new RenderTarget());
+	ResourceManager::getInstance()->addReloadable(target);
+	return target;
+}
+
+RenderTarget::RenderTarget() : mFramebuffer(0), mTextureID(0), mMemUsage(0)
+{
+}
+
+RenderTarget::~RenderTarget()
+{
+	deinit();
+}
+
+void RenderTarget::deinit()
+{
+	Renderer::deleteRenderTarget(mFramebuffer, mTextureID);
+	mFramebuffer = 0;
+	mTextureID = 0;
+
+	sTotalMemUsage -= mMemUsage;
+	mMemUsage = 0;
+}
+
+void RenderTarget::unload(std::shared_ptr<ResourceManager>& rm)
+{
+	deinit();
+}
+
+void RenderTarget::reload(std::shared_ptr<ResourceManager>& rm)
+{
+	// made again when it's needed, whoever uses it has to draw the contents again anyway
+}
+
+bool RenderTarget::bind()
+{
+	if(mFramebuffer == 0)
+	{
+		if(!Renderer::createRenderTarget(&mFramebuffer, &mTextureID))
+			return false;
+
+		mMemUsage = Renderer::getScreenWidth() * Renderer::getScreenHeight() * 4;
+		sTotalMemUsage += mMemUsage;
+	}
+
+	Renderer::pushRenderTarget(mFramebuffer);
+	return true;
+}
+
+void RenderTarget::unbind()
+{
+	Renderer::popRenderTarget();
+}
+
+GLuint RenderTarget::getTextureID() const
+{
+	return mTextureID;
+}
+
+size_t RenderTarget::getTotalMemUsage()
+{
+	return sTotalMemUsage;
+}
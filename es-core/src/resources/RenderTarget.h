@@ -0,0 +1,36 @@
+#pragma once
+
+#include "resources/ResourceManager.h"
+
+#include "platform.h"
+#include GLHEADER
+
+// A screen sized texture that can be rendered into (see Renderer::createRenderTarget).
+// The GL objects are made the first time it's bound and dropped with renderer deinit, the contents are lost then.
+class RenderTarget : public IReloadable
+{
+public:
+	static std::shared_ptr<RenderTarget> create();
+
+	virtual ~RenderTarget();
+
+	virtual void unload(std::shared_ptr<ResourceManager>& rm) override;
+	virtual void reload(std::shared_ptr<ResourceManager>& rm) override;
+
+	bool bind(); // draws go into the texture until unbind(), false if it can't be made
+	void unbind(); // back to whatever was bound before bind()
+	GLuint getTextureID() const; // 0 while there's nothing to draw from
+
+	void deinit(); // frees the GL objects, bind() makes them again
+
+	static size_t getTotalMemUsage(); // VRAM used by all render targets (in bytes)
+
+private:
+	RenderTarget();
+
+	GLuint mFramebuffer;
+	GLuint mTextureID;
+	size_t mMemUsage;
+
+	static size_t sTotalMemUsage;
+};
@@ -4,98 +4,162 @@
 #include "Log.h"
 #include "Util.h"
 #include "ImageIO.h"
+#include "ThreadPool.h"
 
 #define DPI 96
+#define MIN_BAND_PIXELS (128 * 128) // smaller images aren't worth splitting up
 
-SVGResource::SVGResource(const std::string& path, bool tile) : TextureResource(path, tile), mSVGImage(NULL)
+std::map< SVGResource::SVGKeyType, std::weak_ptr<SVGResource> > SVGResource::sSVGMap;
+std::map< std::string, std::weak_ptr<NSVGimage> > SVGResource::sParsedMap;
+
+// creating a rasterizer allocates its edge/span buffers, so each worker keeps one around instead of making one per image
+static NSVGrasterizer* getRasterizer()
+{
+	struct Rasterizer
+	{
+		Rasterizer() : rast(nsvgCreateRasterizer()) {}
+		~Rasterizer() { nsvgDeleteRasterizer(rast); }
+		NSVGrasterizer* rast;
+	};
+
+	static thread_local Rasterizer rasterizer;
+	return rasterizer.rast;
+}
+
+SVGResource::SVGResource(const std::string& path, bool tile, bool mipmap, const std::shared_ptr<NSVGimage>& image, size_t width, size_t height) :
+	TextureResource(path, tile, mipmap), mSVGImage(image), mSourceSize(image->width, image->height), mWidth(width), mHeight(height)
 {
-	mLastWidth = 0;
-	mLastHeight = 0;
 }
 
 SVGResource::~SVGResource()
 {
-	deinitSVG();
 }
 
-void SVGResource::unload(std::shared_ptr<ResourceManager>& rm)
+std::shared_ptr<SVGResource> SVGResource::get(const std::string& path, bool tile, bool mipmap, size_t width, size_t height)
 {
-	deinitSVG();
-	TextureResource::unload(rm);
+	std::shared_ptr<NSVGimage> image = getParsed(path);
+	if(!image)
+		return nullptr;
+
+	if(width == 0 && height == 0)
+	{
+		width = (size_t)round(image->width);
+		height = (size_t)round(image->height);
+	}else if(width == 0)
+	{
+		// auto scale width to keep aspect
+		width = (size_t)round((height / image->height) * image->width);
+	}else if(height == 0)
+	{
+		// auto scale height to keep aspect
+		height = (size_t)round((width / image->width) * image->height);
+	}
+
+	if(width == 0 || height == 0)
+		return nullptr;
+
+	SVGKeyType key(path, tile, mipmap, width, height);
+	auto found = sSVGMap.find(key);
+	if(found != sSVGMap.end() && !found->second.expired())
+		return found->second.lock();
+
+	std::shared_ptr<SVGResource> svg(new SVGResource(path, tile, mipmap, image, width, height));
+	sSVGMap[key] = svg;
+	sTextureList.push_back(svg);
+	ResourceManager::getInstance()->addReloadable(svg);
+	svg->rasterize();
+	return svg;
 }
 
-void SVGResource::initFromMemory(const char* file, size_t length)
+std::shared_ptr<NSVGimage> SVGResource::getParsed(const std::string& path)
 {
-	deinit();
-	deinitSVG();
+	auto found = sParsedMap.find(path);
+	if(found != sParsedMap.end() && !found->second.expired())
+		return found->second.lock();
+
+	const ResourceData data = ResourceManager::getInstance()->getFileData(path);
 
 	// nsvgParse excepts a modifiable, null-terminated string
-	char* copy = (char*)malloc(length + 1);
+	char* copy = (char*)malloc(data.length + 1);
 	assert(copy != NULL);
-	memcpy(copy, file, length);
-	copy[length] = '\0';
+	memcpy(copy, data.ptr.get(), data.length);
+	copy[data.length] = '\0';
 
-	mSVGImage = nsvgParse(copy, "px", DPI);
+	NSVGimage* image = nsvgParse(copy, "px", DPI);
 	free(copy);
 
-	if(!mSVGImage)
+	if(!image)
 	{
-		LOG(LogError) << "Error parsing SVG image.";
-		return;
+		LOG(LogError) << "Error parsing SVG image \"" << path << "\".";
+		return nullptr;
 	}
 
-	if(mLastWidth && mLastHeight)
-		rasterizeAt(mLastWidth, mLastHeight);
-	else
-		rasterizeAt((size_t)round(mSVGImage->width), (size_t)round(mSVGImage->height));
+	std::shared_ptr<NSVGimage> parsed(image, nsvgDelete);
+	sParsedMap[path] = parsed;
+	return parsed;
+}
+
+void SVGResource::unload(std::shared_ptr<ResourceManager>& rm)
+{
+	// atlased and shadow copied textures survive unloading (see TextureResource::unload) and never need to be rasterized again
+	TextureResource::unload(rm);
+	if(!isInitialized())
+		mSVGImage.reset();
 }
 
-void SVGResource::rasterizeAt(size_t width, size_t height)
+void SVGResource::reload(std::shared_ptr<ResourceManager>& rm)
 {
-	if(!mSVGImage || (width == 0 && height == 0))
+	if(restoreShadowCopy() || isInitialized())
 		return;
 
-	if(width == 0)
-	{
-		// auto scale width to keep aspect
-		width = (size_t)round((height / mSVGImage->height) * mSVGImage->width);
-	}else if(height == 0)
-	{
-		// auto scale height to keep aspect
-		height = (size_t)round((width / mSVGImage->width) * mSVGImage->height);
-	}
+	if(!mSVGImage)
+		mSVGImage = getParsed(mPath);
 
-	if(width != (size_t)round(mSVGImage->width) && height != (size_t)round(mSVGImage->height))
-	{
-		mLastWidth = width;
-		mLastHeight = height;
-	}
+	rasterize();
+}
 
-	unsigned char* imagePx = (unsigned char*)malloc(width * height * 4);
-	assert(imagePx != NULL);
+void SVGResource::rasterize()
+{
+	if(!mSVGImage)
+		return;
 
-	NSVGrasterizer* rast = nsvgCreateRasterizer();
-	nsvgRasterize(rast, mSVGImage, 0, 0, height / mSVGImage->height, imagePx, width, height, width * 4);
-	nsvgDeleteRasterizer(rast);
+	// everything the workers need is copied or shared, we might be gone before they're done
+	const size_t width = mWidth;
+	const size_t height = mHeight;
+	const float scale = height / mSVGImage->height;
+	std::shared_ptr<NSVGimage> image = mSVGImage;
+	std::shared_ptr< std::vector<unsigned char> > pixels(new std::vector<unsigned char>(width * height * 4));
 
-	ImageIO::flipPixelsVert(imagePx, width, height);
+	// big images are split into horizontal bands so every worker gets a share
+	ThreadPool* pool = ThreadPool::getInstance();
+	const size_t bandCount = std::max<size_t>(1, std::min<size_t>(pool->getThreadCount(), (width * height) / MIN_BAND_PIXELS));
+	const size_t bandHeight = (height + bandCount - 1) / bandCount;
 
-	initFromPixels(imagePx, width, height);
-	free(imagePx);
-}
+	std::shared_ptr< std::vector< std::future<void> > > bands(new std::vector< std::future<void> >());
+	for(size_t y = 0; y < height; y += bandHeight)
+	{
+		const size_t rows = std::min(bandHeight, height - y);
+		bands->push_back(pool->queue([image, pixels, width, scale, y, rows] {
+			nsvgRasterize(getRasterizer(), image.get(), 0, -(float)y, scale, pixels->data() + y * width * 4, width, rows, width * 4);
+		}));
+	}
 
-Eigen::Vector2f SVGResource::getSourceImageSize() const
-{
-	if(mSVGImage)
-		return Eigen::Vector2f(mSVGImage->width, mSVGImage->height);
+	// runs when the texture is first bound
+	initFromPixelsAsync(std::async(std::launch::deferred, [pixels, bands, width, height] () -> std::vector<unsigned char> {
+		for(auto it = bands->begin(); it != bands->end(); it++)
+			it->get();
 
-	return Eigen::Vector2f::Zero();
+		ImageIO::flipPixelsVert(pixels->data(), width, height);
+		return std::move(*pixels);
+	}), width, height);
 }
 
-void SVGResource::deinitSVG()
+std::shared_ptr<SVGResource> SVGResource::getRasterized(size_t width, size_t height) const
 {
-	if(mSVGImage)
-		nsvgDelete(mSVGImage);
+	return get(mPath, mTile, mMipmap, width, height);
+}
 
-	mSVGImage = NULL;
+Eigen::Vector2f SVGResource::getSourceImageSize() const
+{
+	return mSourceSize;
 }
@@ -4,24 +4,37 @@
 
 struct NSVGimage;
 
+// An SVG rasterized at one particular size.
+// Rasterizations are shared between everyone asking for the same (path, size), and parsed SVGs are shared between all sizes of the same path.
 class SVGResource : public TextureResource
 {
 public:
+	// width or height may be zero to keep the aspect ratio, both zero means the SVG's own size.
+	static std::shared_ptr<SVGResource> get(const std::string& path, bool tile, bool mipmap, size_t width, size_t height);
+
 	virtual ~SVGResource();
 
 	virtual void unload(std::shared_ptr<ResourceManager>& rm) override;
-	
-	virtual void initFromMemory(const char* image, size_t length) override;
+	virtual void reload(std::shared_ptr<ResourceManager>& rm) override;
 
-	void rasterizeAt(size_t width, size_t height);
+	// Returns the same SVG rasterized at another size. This never changes this texture, others might be using it.
+	std::shared_ptr<SVGResource> getRasterized(size_t width, size_t height) const;
 	Eigen::Vector2f getSourceImageSize() const;
 
 protected:
-	friend TextureResource;
-	SVGResource(const std::string& path, bool tile);
-	void deinitSVG();
+	SVGResource(const std::string& path, bool tile, bool mipmap, const std::shared_ptr<NSVGimage>& image, size_t width, size_t height);
+
+	void rasterize();
+
+	// parses path, or returns the already parsed image if someone else is still using it
+	static std::shared_ptr<NSVGimage> getParsed(const std::string& path);
+
+	std::shared_ptr<NSVGimage> mSVGImage; // released while unloaded
+	Eigen::Vector2f mSourceSize;
+	const size_t mWidth;
+	const size_t mHeight;
 
-	NSVGimage* mSVGImage;
-	size_t mLastWidth;
-	size_t mLastHeight;
+	typedef std::tuple<std::string, bool, bool, size_t, size_t> SVGKeyType; // path, tile, mipmap, width, height
+	static std::map< SVGKeyType, std::weak_ptr<SVGResource> > sSVGMap;
+	static std::map< std::string, std::weak_ptr<NSVGimage> > sParsedMap;
 };
@@ -0,0 +1,240 @@
+#include "resources/TextureAtlas.h"
+#include "Log.h"
+#include "Renderer.h"
+#include <string.h>
+
+#define PAGE_SIZE 1024
+#define MAX_IMAGE_SIZE 128
+#define PADDING 1 // edge pixels are repeated into the padding so linear filtering never picks up a neighbour
+
+std::shared_ptr<TextureAtlas> TextureAtlas::sInstance = nullptr;
+
+TextureAtlas::TextureAtlas()
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	unload(ResourceManager::getInstance());
+}
+
+std::shared_ptr<TextureAtlas>& TextureAtlas::getInstance()
+{
+	if(!sInstance)
+	{
+		sInstance = std::shared_ptr<TextureAtlas>(new TextureAtlas());
+		ResourceManager::getInstance()->addReloadable(sInstance);
+	}
+
+	return sInstance;
+}
+
+void TextureAtlas::unload(std::shared_ptr<ResourceManager>& rm)
+{
+	// the CPU copies stay around, reload() uploads them again
+	for(auto it = mPages.begin(); it != mPages.end(); it++)
+	{
+		if(it->textureID != 0)
+		{
+			Renderer::deleteTexture(it->textureID);
+			it->textureID = 0;
+		}
+	}
+}
+
+void TextureAtlas::reload(std::shared_ptr<ResourceManager>& rm)
+{
+	for(auto it = mPages.begin(); it != mPages.end(); it++)
+	{
+		if(!it->pixels.empty() && it->textureID == 0)
+			upload(*it);
+	}
+}
+
+bool TextureAtlas::fits(size_t width, size_t height)
+{
+	return width > 0 && height > 0 && width <= MAX_IMAGE_SIZE && height <= MAX_IMAGE_SIZE;
+}
+
+bool TextureAtlas::allocate(Page& page, const Eigen::Vector2i& slotSize, Region& region)
+{
+	// reuse the smallest free slot that's big enough (images are usually replaced by one of the same size, e.g. when an SVG is rasterized again)
+	auto bestSlot = page.freeSlots.end();
+	for(auto it = page.freeSlots.begin(); it != page.freeSlots.end(); it++)
+	{
+		if(it->slotSize.x() >= slotSize.x() && it->slotSize.y() >= slotSize.y() &&
+			(bestSlot == page.freeSlots.end() || it->slotSize.prod() < bestSlot->slotSize.prod()))
+			bestSlot = it;
+	}
+
+	if(bestSlot != page.freeSlots.end())
+	{
+		region = *bestSlot;
+		page.freeSlots.erase(bestSlot);
+		return true;
+	}
+
+	// put it on the lowest shelf that's tall enough without wasting more than half of the image's height
+	Shelf* bestShelf = NULL;
+	for(auto it = page.shelves.begin(); it != page.shelves.end(); it++)
+	{
+		if(it->height >= slotSize.y() && it->height <= slotSize.y() + slotSize.y() / 2 && PAGE_SIZE - it->usedWidth >= slotSize.x() &&
+			(bestShelf == NULL || it->height < bestShelf->height))
+			bestShelf = &(*it);
+	}
+
+	if(bestShelf == NULL)
+	{
+		if(PAGE_SIZE - page.shelvesHeight < slotSize.y())
+			return false;
+
+		Shelf shelf = { page.shelvesHeight, slotSize.y(), 0 };
+		page.shelves.push_back(shelf);
+		page.shelvesHeight += slotSize.y();
+		bestShelf = &page.shelves.back();
+	}
+
+	region.slotPos << bestShelf->usedWidth, bestShelf->y;
+	region.slotSize << slotSize.x(), bestShelf->height;
+	bestShelf->usedWidth += slotSize.x();
+	return true;
+}
+
+TextureAtlas::Region TextureAtlas::reserve(size_t width, size_t height)
+{
+	Region region;
+	if(!fits(width, height))
+		return region;
+
+	const Eigen::Vector2i slotSize((int)width + PADDING * 2, (int)height + PADDING * 2);
+
+	for(unsigned int i = 0; i < mPages.size(); i++)
+	{
+		if(allocate(mPages[i], slotSize, region))
+		{
+			region.page = i;
+			break;
+		}
+	}
+
+	if(!region.isValid())
+	{
+		mPages.push_back(Page());
+		if(!allocate(mPages.back(), slotSize, region))
+			return region;
+		region.page = mPages.size() - 1;
+	}
+
+	region.pos = region.slotPos + Eigen::Vector2i(PADDING, PADDING);
+	region.size << (int)width, (int)height;
+
+	Page& page = mPages.at(region.page);
+	if(page.pixels.empty())
+		page.pixels.resize(PAGE_SIZE * PAGE_SIZE * 4, 0);
+	if(page.textureID == 0)
+		upload(page);
+
+	page.usedSlots++;
+	return region;
+}
+
+void TextureAtlas::write(const Region& region, const unsigned char* dataRGBA)
+{
+	Page& page = mPages.at(region.page);
+	const size_t width = region.size.x();
+	const size_t height = region.size.y();
+	const Eigen::Vector2i slotSize((int)width + PADDING * 2, (int)height + PADDING * 2);
+
+	// build the padded block, then copy it into the CPU copy and the texture
+	std::vector<unsigned char> block(slotSize.x() * slotSize.y() * 4);
+	for(int y = 0; y < slotSize.y(); y++)
+	{
+		const int srcY = std::min(std::max(y - PADDING, 0), (int)height - 1);
+		const unsigned char* src = dataRGBA + srcY * width * 4;
+		unsigned char* dst = block.data() + y * slotSize.x() * 4;
+
+		memcpy(dst, src, 4); // left padding
+		memcpy(dst + PADDING * 4, src, width * 4);
+		memcpy(dst + (PADDING + width) * 4, src + (width - 1) * 4, 4); // right padding
+
+		memcpy(page.pixels.data() + ((region.slotPos.y() + y) * PAGE_SIZE + region.slotPos.x()) * 4, dst, slotSize.x() * 4);
+	}
+
+	Renderer::bindTexture(page.textureID);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, region.slotPos.x(), region.slotPos.y(), slotSize.x(), slotSize.y(), GL_RGBA, GL_UNSIGNED_BYTE, block.data());
+}
+
+TextureAtlas::Region TextureAtlas::insert(const unsigned char* dataRGBA, size_t width, size_t height)
+{
+	Region region = reserve(width, height);
+	if(region.isValid())
+		write(region, dataRGBA);
+
+	return region;
+}
+
+void TextureAtlas::remove(const Region& region)
+{
+	if(!region.isValid() || region.page >= (int)mPages.size())
+		return;
+
+	Page& page = mPages.at(region.page);
+	page.freeSlots.push_back(region);
+	page.usedSlots--;
+
+	// empty pages give their memory back, but stay in mPages so page indices don't change
+	if(page.usedSlots <= 0)
+	{
+		if(page.textureID != 0)
+			Renderer::deleteTexture(page.textureID);
+
+		page = Page();
+	}
+}
+
+Eigen::Vector4f TextureAtlas::getTextureRect(const Region& region) const
+{
+	const Eigen::Vector2f min = region.pos.cast<float>() / PAGE_SIZE;
+	const Eigen::Vector2f max = (region.pos + region.size).cast<float>() / PAGE_SIZE;
+	return Eigen::Vector4f(min.x(), min.y(), max.x(), max.y());
+}
+
+GLuint TextureAtlas::getTextureID(const Region& region) const
+{
+	return region.isValid() ? mPages.at(region.page).textureID : 0;
+}
+
+void TextureAtlas::bind(const Region& region) const
+{
+	const GLuint textureID = getTextureID(region);
+	if(textureID != 0)
+		Renderer::bindTexture(textureID);
+	else
+		LOG(LogError) << "Tried to bind uninitialized texture atlas page!";
+}
+
+void TextureAtlas::upload(Page& page)
+{
+	glGenTextures(1, &page.textureID);
+	Renderer::bindTexture(page.textureID);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, PAGE_SIZE, PAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, page.pixels.data());
+
+	// same filtering as a standalone TextureResource
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+size_t TextureAtlas::getMemUsage() const
+{
+	size_t total = 0;
+	for(auto it = mPages.begin(); it != mPages.end(); it++)
+	{
+		if(it->textureID != 0)
+			total += PAGE_SIZE * PAGE_SIZE * 4;
+	}
+
+	return total;
+}
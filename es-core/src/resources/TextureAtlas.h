@@ -0,0 +1,82 @@
+#pragma once
+
+#include "resources/ResourceManager.h"
+
+#include <vector>
+#include <Eigen/Dense>
+#include "platform.h"
+#include GLHEADER
+
+// Packs small textures (help icons, stars, ninepatch frames, checkboxes...) into a few big GL textures ("pages"),
+// so drawing a screen full of them needs far fewer texture switches.
+// A CPU copy of every page is kept, so the atlas can restore itself after the renderer is deinitialized.
+// Regions never move while they're in use - texture coordinates stay valid across unload/reload.
+class TextureAtlas : public IReloadable
+{
+public:
+	struct Region
+	{
+		Region() : page(-1) {}
+		bool isValid() const { return page >= 0; }
+
+		int page;
+		Eigen::Vector2i pos; // the image itself
+		Eigen::Vector2i size;
+		Eigen::Vector2i slotPos; // the whole slot, including the padding around the image
+		Eigen::Vector2i slotSize;
+	};
+
+	static std::shared_ptr<TextureAtlas>& getInstance();
+
+	virtual ~TextureAtlas();
+
+	virtual void unload(std::shared_ptr<ResourceManager>& rm) override;
+	virtual void reload(std::shared_ptr<ResourceManager>& rm) override;
+
+	// Only textures up to this size are worth packing.
+	static bool fits(size_t width, size_t height);
+
+	// Finds a free spot for an image. Returns an invalid region if the image doesn't fit (see fits()).
+	Region reserve(size_t width, size_t height);
+	// Copies the image into its region.
+	void write(const Region& region, const unsigned char* dataRGBA);
+	// reserve() + write()
+	Region insert(const unsigned char* dataRGBA, size_t width, size_t height);
+	void remove(const Region& region);
+
+	// Returns where the image is inside the page, in texture coordinates (min x, min y, max x, max y).
+	Eigen::Vector4f getTextureRect(const Region& region) const;
+	GLuint getTextureID(const Region& region) const;
+	void bind(const Region& region) const;
+
+	size_t getMemUsage() const; // VRAM used by all pages (in bytes)
+
+private:
+	TextureAtlas();
+
+	struct Shelf
+	{
+		int y;
+		int height;
+		int usedWidth;
+	};
+
+	struct Page
+	{
+		Page() : textureID(0), usedSlots(0), shelvesHeight(0) {}
+
+		GLuint textureID;
+		std::vector<unsigned char> pixels; // CPU copy, used to restore the texture
+		std::vector<Shelf> shelves;
+		std::vector<Region> freeSlots; // slots that were used and then removed
+		int usedSlots;
+		int shelvesHeight;
+	};
+
+	bool allocate(Page& page, const Eigen::Vector2i& slotSize, Region& region);
+	void upload(Page& page);
+
+	static std::shared_ptr<TextureAtlas> sInstance;
+
+	std::vector<Page> mPages;
+};
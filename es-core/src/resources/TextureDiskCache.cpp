@@ -0,0 +1,322 @@
+#include "resources/TextureDiskCache.h"
+#include "resources/ResourceManager.h"
+#include "ImageIO.h"
+#include "Log.h"
+#include "Settings.h"
+#include "Util.h"
+#include "platform.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <boost/filesystem.hpp>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = boost::filesystem;
+
+#define BLOB_VERSION 2
+#define EVICT_TO 0.75 // evicting goes this far below the limit, so the next few stores don't scan the directory again
+#define TOUCH_INTERVAL 3600 // seconds, how often a hit refreshes a blob's time for the LRU order
+
+// the header is followed directly by width * height * 4 bytes of RGBA pixels (in the same row order ImageIO produces)
+struct BlobHeader
+{
+	char magic[4]; // "ESTC"
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	int64_t sourceTime; // modification time of the source image
+	uint32_t maxWidth;
+	uint32_t maxHeight;
+};
+
+static const char BLOB_MAGIC[4] = { 'E', 'S', 'T', 'C' };
+
+// FNV-1a, stable between runs and builds (unlike std::hash)
+static uint64_t hashBytes(const void* data, size_t length, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for(size_t i = 0; i < length; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static int64_t getSourceTime(const std::string& path)
+{
+	boost::system::error_code ec;
+	std::time_t time = fs::last_write_time(path, ec);
+	return ec ? 0 : (int64_t)time;
+}
+
+uint64_t TextureDiskCache::sSize = 0;
+bool TextureDiskCache::sSizeKnown = false;
+std::mutex TextureDiskCache::sMutex;
+
+TextureDiskCache::Blob::Blob() : mMapping(NULL), mMappingLength(0), mPixels(NULL), mWidth(0), mHeight(0)
+{
+}
+
+TextureDiskCache::Blob::~Blob()
+{
+#ifndef WIN32
+	if(mMapping)
+		munmap(mMapping, mMappingLength);
+#endif
+}
+
+bool TextureDiskCache::isEnabled()
+{
+	return Settings::getInstance()->getBool("TextureDiskCache");
+}
+
+bool TextureDiskCache::isCacheable(const std::string& path)
+{
+	if(path.size() < 4 || path.substr(path.size() - 4, std::string::npos) == ".svg")
+		return false;
+
+	// embedded resources (":/...") never exist on disk
+	boost::system::error_code ec;
+	return fs::is_regular_file(path, ec);
+}
+
+Eigen::Vector2i TextureDiskCache::getScaledSize(const Eigen::Vector2i& imageSize, const Eigen::Vector2i& maxSize)
+{
+	if(maxSize.x() <= 0 || maxSize.y() <= 0 || (imageSize.x() <= maxSize.x() && imageSize.y() <= maxSize.y()))
+		return imageSize;
+
+	const float scale = std::min((float)maxSize.x() / imageSize.x(), (float)maxSize.y() / imageSize.y());
+	return Eigen::Vector2i(std::max(1, (int)(imageSize.x() * scale + 0.5f)), std::max(1, (int)(imageSize.y() * scale + 0.5f)));
+}
+
+std::string TextureDiskCache::getCacheDirectory()
+{
+	return getHomePath() + "/.emulationstation/cache/textures/";
+}
+
+std::string TextureDiskCache::getBlobPath(const std::string& path)
+{
+	// the source time and max size are checked against the header, a stale blob is simply overwritten
+	const uint64_t hash = hashBytes(path.c_str(), path.size());
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.tex", (unsigned long long)hash);
+	return getCacheDirectory() + name;
+}
+
+std::unique_ptr<TextureDiskCache::Blob> TextureDiskCache::open(const std::string& path, const Eigen::Vector2i& maxSize)
+{
+	const std::string blobPath = getBlobPath(path);
+
+	std::unique_ptr<Blob> blob(new Blob());
+	const unsigned char* data = NULL;
+	size_t length = 0;
+
+#ifndef WIN32
+	int fd = ::open(blobPath.c_str(), O_RDONLY);
+	if(fd < 0)
+		return nullptr;
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BlobHeader))
+	{
+		close(fd);
+		return nullptr;
+	}
+
+	length = (size_t)st.st_size;
+	void* mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(mapping == MAP_FAILED)
+		return nullptr;
+
+	blob->mMapping = mapping;
+	blob->mMappingLength = length;
+	data = (const unsigned char*)mapping;
+#else
+	std::ifstream stream(blobPath, std::ios::binary | std::ios::ate);
+	if(!stream)
+		return nullptr;
+
+	length = (size_t)stream.tellg();
+	if(length < sizeof(BlobHeader))
+		return nullptr;
+
+	blob->mBuffer.resize(length);
+	stream.seekg(0, stream.beg);
+	stream.read((char*)blob->mBuffer.data(), length);
+	data = blob->mBuffer.data();
+#endif
+
+	const BlobHeader* header = (const BlobHeader*)data;
+	if(memcmp(header->magic, BLOB_MAGIC, sizeof(BLOB_MAGIC)) != 0 || header->version != BLOB_VERSION ||
+		header->width == 0 || header->height == 0 || length != sizeof(BlobHeader) + (size_t)header->width * header->height * 4)
+	{
+		LOG(LogWarning) << "Ignoring invalid texture cache entry \"" << blobPath << "\" (for \"" << path << "\")";
+		return nullptr;
+	}
+
+	// stale, store() replaces it
+	if(header->sourceTime != getSourceTime(path) || header->maxWidth != (uint32_t)maxSize.x() || header->maxHeight != (uint32_t)maxSize.y())
+		return nullptr;
+
+	// reading doesn't reliably update the access time, so hits move the blob up in the LRU order by touching it
+	boost::system::error_code ec;
+	const std::time_t now = std::time(NULL);
+	if(now - fs::last_write_time(blobPath, ec) > TOUCH_INTERVAL && !ec)
+		fs::last_write_time(blobPath, now, ec);
+
+	blob->mWidth = header->width;
+	blob->mHeight = header->height;
+	blob->mPixels = data + sizeof(BlobHeader);
+	return blob;
+}
+
+bool TextureDiskCache::store(const std::string& path, const Eigen::Vector2i& maxSize, std::vector<unsigned char>& dataRGBA, size_t& width, size_t& height)
+{
+	const Eigen::Vector2i scaledSize = getScaledSize(Eigen::Vector2i((int)width, (int)height), maxSize);
+	if(scaledSize.x() != (int)width || scaledSize.y() != (int)height)
+	{
+		dataRGBA = ImageIO::scaleRGBA32(dataRGBA.data(), width, height, scaledSize.x(), scaledSize.y());
+		width = scaledSize.x();
+		height = scaledSize.y();
+	}
+
+	// stores run on workers, one at a time (they'd share the temporary file and the size count otherwise)
+	std::lock_guard<std::mutex> lock(sMutex);
+
+	const std::string dir = getCacheDirectory();
+	boost::system::error_code ec;
+	if(!fs::exists(dir, ec))
+		fs::create_directories(dir, ec);
+
+	BlobHeader header;
+	memcpy(header.magic, BLOB_MAGIC, sizeof(BLOB_MAGIC));
+	header.version = BLOB_VERSION;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.sourceTime = getSourceTime(path);
+	header.maxWidth = (uint32_t)maxSize.x();
+	header.maxHeight = (uint32_t)maxSize.y();
+
+	// write to a temporary file first so an interrupted write never leaves a truncated blob behind
+	const std::string blobPath = getBlobPath(path);
+	const std::string tempPath = blobPath + ".tmp";
+	{
+		std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+		stream.write((const char*)&header, sizeof(header));
+		stream.write((const char*)dataRGBA.data(), width * height * 4);
+		if(!stream)
+		{
+			LOG(LogWarning) << "Could not write texture cache entry \"" << tempPath << "\"";
+			stream.close();
+			fs::remove(tempPath, ec);
+			return false;
+		}
+	}
+
+	const uint64_t maxBytes = (uint64_t)std::max(Settings::getInstance()->getInt("TextureDiskCacheSize"), 0) * 1024 * 1024;
+	if(!sSizeKnown)
+		evict(maxBytes);
+
+	// a stale blob for the same source gets replaced
+	const uintmax_t oldSize = fs::file_size(blobPath, ec);
+	if(!ec)
+		sSize -= std::min((uint64_t)oldSize, sSize);
+
+	fs::rename(tempPath, blobPath, ec);
+	if(ec)
+	{
+		LOG(LogWarning) << "Could not write texture cache entry \"" << blobPath << "\" - " << ec.message();
+		fs::remove(tempPath, ec);
+		sSizeKnown = false;
+		return false;
+	}
+
+	sSize += sizeof(header) + (uint64_t)width * height * 4;
+	if(sSize > maxBytes)
+		evict(maxBytes);
+
+	return true;
+}
+
+void TextureDiskCache::evict(uint64_t maxBytes)
+{
+	struct Entry
+	{
+		std::time_t time;
+		uint64_t size;
+		fs::path path;
+	};
+
+	std::vector<Entry> entries;
+	sSize = 0;
+	sSizeKnown = true;
+
+	boost::system::error_code ec;
+	for(fs::directory_iterator it(getCacheDirectory(), ec), end; !ec && it != end; it.increment(ec))
+	{
+		boost::system::error_code fileEc;
+		Entry entry;
+		entry.path = it->path();
+		entry.time = fs::last_write_time(entry.path, fileEc);
+		entry.size = fs::file_size(entry.path, fileEc);
+		if(fileEc || entry.path.extension() != ".tex")
+			continue;
+
+		sSize += entry.size;
+		entries.push_back(entry);
+	}
+
+	if(sSize <= maxBytes)
+		return;
+
+	// oldest first
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+
+	const uint64_t target = (uint64_t)(maxBytes * EVICT_TO);
+	unsigned int evicted = 0;
+	for(auto it = entries.begin(); it != entries.end() && sSize > target; it++)
+	{
+		if(fs::remove(it->path, ec))
+		{
+			sSize -= it->size;
+			evicted++;
+		}
+	}
+
+	LOG(LogInfo) << "Evicted " << evicted << " texture cache entries, " << sSize / 1024 / 1024 << "MB left";
+}
+
+bool TextureDiskCache::warm(const std::string& imagePath, const Eigen::Vector2i& maxSize)
+{
+	// TextureResource keys everything by canonical path, so we have to as well
+	const std::string path = getCanonicalPath(imagePath);
+	if(!isCacheable(path))
+		return false;
+
+	if(open(path, maxSize))
+		return true;
+
+	const ResourceData data = ResourceManager::getInstance()->getFileData(path);
+	size_t width, height;
+	std::vector<unsigned char> imageRGBA = ImageIO::loadFromMemoryRGBA32(data.ptr.get(), data.length, width, height);
+	if(imageRGBA.empty())
+	{
+		LOG(LogError) << "Could not decode \"" << path << "\" for the texture cache";
+		return false;
+	}
+
+	return store(path, maxSize, imageRGBA, width, height);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <Eigen/Dense>
+
+// A persistent on-disk cache of decoded images, stored in ~/.emulationstation/cache/textures/.
+// Images are decoded once, downscaled so they fit within a maximum size (usually the screen) and written out as raw RGBA blobs.
+// A cached blob is memory-mapped and handed straight to TextureResource::initFromPixels, so FreeImage is skipped entirely.
+// There is one blob per source path. It remembers the source's modification time and the maximum size, so editing an image or changing
+// resolution is a cache miss and the blob is replaced. Past the "TextureDiskCacheSize" setting the least recently used blobs are evicted.
+class TextureDiskCache
+{
+public:
+	// A read-only view of a cached blob. The pixels are only valid while the Blob is alive.
+	class Blob
+	{
+	public:
+		~Blob();
+
+		inline const unsigned char* getPixels() const { return mPixels; }
+		inline size_t getWidth() const { return mWidth; }
+		inline size_t getHeight() const { return mHeight; }
+
+	private:
+		friend TextureDiskCache;
+		Blob();
+
+		void* mMapping;
+		size_t mMappingLength;
+		std::vector<unsigned char> mBuffer; // used instead of mMapping where mmap is unavailable
+
+		const unsigned char* mPixels;
+		size_t mWidth;
+		size_t mHeight;
+	};
+
+	static bool isEnabled();
+
+	// Only regular image files on disk are cached (no embedded resources, no SVGs).
+	static bool isCacheable(const std::string& path);
+
+	// Returns the size an image will be stored at so it fits within maxSize. Never upscales. A zero maxSize means "don't scale".
+	static Eigen::Vector2i getScaledSize(const Eigen::Vector2i& imageSize, const Eigen::Vector2i& maxSize);
+
+	// Returns nullptr if there is no valid blob for this path/maxSize.
+	static std::unique_ptr<Blob> open(const std::string& path, const Eigen::Vector2i& maxSize);
+
+	// Downscales dataRGBA (updating width and height) according to maxSize and writes it to the cache. Safe to call from a worker thread.
+	static bool store(const std::string& path, const Eigen::Vector2i& maxSize, std::vector<unsigned char>& dataRGBA, size_t& width, size_t& height);
+
+	// Decodes and stores path if it is not already cached. Used to prepare a whole collection offline (--warm-texture-cache).
+	static bool warm(const std::string& path, const Eigen::Vector2i& maxSize);
+
+	static std::string getCacheDirectory();
+
+private:
+	static std::string getBlobPath(const std::string& path);
+
+	// deletes the least recently used blobs until the cache is well below maxBytes, also recounts sSize
+	static void evict(uint64_t maxBytes);
+
+	static uint64_t sSize; // bytes on disk, counted on the first store()
+	static bool sSizeKnown;
+	static std::mutex sMutex; // held by store()
+};
@@ -5,13 +5,65 @@
 #include "ImageIO.h"
 #include "Renderer.h"
 #include "Util.h"
+#include "Settings.h"
+#include "ThreadPool.h"
 #include "resources/SVGResource.h"
+#include "resources/TextureDiskCache.h"
+#include <SDL.h>
+#include <stdlib.h>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+typedef void (APIENTRY *GenerateMipmapProc)(GLenum target);
+
+// Returns the driver's glGenerateMipmap (core in GL 3.0, otherwise from the FBO extensions), or NULL if there isn't one.
+static GenerateMipmapProc getGenerateMipmap()
+{
+#if defined(USE_OPENGL_ES) && defined(USE_OPENGL_SHADERS)
+	return (GenerateMipmapProc)glGenerateMipmap; // core in GLES 2.0
+#elif defined(USE_OPENGL_ES)
+	if(SDL_GL_ExtensionSupported("GL_OES_framebuffer_object"))
+		return (GenerateMipmapProc)SDL_GL_GetProcAddress("glGenerateMipmapOES");
+#else
+	const char* version = (const char*)glGetString(GL_VERSION);
+	if((version && atoi(version) >= 3) || SDL_GL_ExtensionSupported("GL_ARB_framebuffer_object"))
+		return (GenerateMipmapProc)SDL_GL_GetProcAddress("glGenerateMipmap");
+	if(SDL_GL_ExtensionSupported("GL_EXT_framebuffer_object"))
+		return (GenerateMipmapProc)SDL_GL_GetProcAddress("glGenerateMipmapEXT");
+#endif
+	return NULL;
+}
+
+static bool isPowerOfTwo(size_t value)
+{
+	return value > 0 && (value & (value - 1)) == 0;
+}
+
+// Mipmapping a non power of two texture needs full NPOT support (GL 2.0, otherwise an extension), else the texture is incomplete and draws black.
+static bool canMipmap(size_t width, size_t height)
+{
+	if(isPowerOfTwo(width) && isPowerOfTwo(height))
+		return true;
+
+#if defined(USE_OPENGL_ES)
+	if(SDL_GL_ExtensionSupported("GL_OES_texture_npot"))
+		return true;
+#else
+	const char* version = (const char*)glGetString(GL_VERSION);
+	if((version && atoi(version) >= 2) || SDL_GL_ExtensionSupported("GL_ARB_texture_non_power_of_two"))
+		return true;
+#endif
+	return false;
+}
 
 std::map< TextureResource::TextureKeyType, std::weak_ptr<TextureResource> > TextureResource::sTextureMap;
 std::list< std::weak_ptr<TextureResource> > TextureResource::sTextureList;
 
-TextureResource::TextureResource(const std::string& path, bool tile) : 
-	mTextureID(0), mPath(path), mTextureSize(Eigen::Vector2i::Zero()), mTile(tile)
+TextureResource::TextureResource(const std::string& path, bool tile, bool mipmap) : 
+	mTextureSize(Eigen::Vector2i::Zero()), mPath(path), mTile(tile), mMipmap(mipmap), mTextureID(0), mTextureRect(0, 0, 1, 1),
+	mHasMipmaps(false)
 {
 }
 
@@ -22,13 +74,41 @@ TextureResource::~TextureResource()
 
 void TextureResource::unload(std::shared_ptr<ResourceManager>& rm)
 {
+	// the atlas restores its pages by itself, and keeping our region means texture coordinates handed out stay valid
+	// (pixels that haven't been uploaded yet don't need a GL context either)
+	if(isAtlased() || mPendingPixels.valid())
+		return;
+
+	// with a shadow copy only the GL texture goes, reload() uploads the copy again
+	if(!mShadowPixels.empty())
+	{
+		mPendingMipmaps = std::future< std::vector<MipLevel> >();
+		mHasMipmaps = false;
+		Renderer::deleteTexture(mTextureID);
+		mTextureID = 0;
+		return;
+	}
+
 	deinit();
 }
 
 void TextureResource::reload(std::shared_ptr<ResourceManager>& rm)
 {
+	if(restoreShadowCopy() || isInitialized())
+		return;
+
 	if(!mPath.empty())
 	{
+		if(isDiskCached())
+		{
+			std::unique_ptr<TextureDiskCache::Blob> blob = TextureDiskCache::open(mPath, getDiskCacheMaxSize());
+			if(blob)
+			{
+				initFromPixels(blob->getPixels(), blob->getWidth(), blob->getHeight());
+				return;
+			}
+		}
+
 		const ResourceData& data = rm->getFileData(mPath);
 		initFromMemory((const char*)data.ptr.get(), data.length);
 	}
@@ -40,9 +120,81 @@ void TextureResource::initFromPixels(const unsigned char* dataRGBA, size_t width
 
 	assert(width > 0 && height > 0);
 
+	mTextureSize << width, height;
+
+	if(!mTile && !mMipmap && TextureAtlas::fits(width, height))
+	{
+		mAtlas = TextureAtlas::getInstance();
+		mAtlasRegion = mAtlas->insert(dataRGBA, width, height);
+		if(mAtlasRegion.isValid())
+		{
+			mTextureRect = mAtlas->getTextureRect(mAtlasRegion);
+			return;
+		}
+
+		mAtlas.reset();
+	}
+
+	createTexture(dataRGBA, width, height);
+}
+
+void TextureResource::initFromPixelsAsync(std::future< std::vector<unsigned char> > dataRGBA, size_t width, size_t height)
+{
+	deinit();
+
+	assert(width > 0 && height > 0);
+
+	mTextureSize << width, height;
+
+	// reserve our atlas spot now, so texture coordinates are known before the pixels are
+	if(!mTile && !mMipmap && TextureAtlas::fits(width, height))
+	{
+		mAtlas = TextureAtlas::getInstance();
+		mAtlasRegion = mAtlas->reserve(width, height);
+		if(mAtlasRegion.isValid())
+			mTextureRect = mAtlas->getTextureRect(mAtlasRegion);
+		else
+			mAtlas.reset();
+	}
+
+	mPendingPixels = std::move(dataRGBA);
+}
+
+void TextureResource::uploadPendingPixels()
+{
+	if(!mPendingPixels.valid())
+		return;
+
+	const std::vector<unsigned char> dataRGBA = mPendingPixels.get();
+	if(dataRGBA.size() != (size_t)mTextureSize.x() * mTextureSize.y() * 4)
+	{
+		LOG(LogError) << "Texture data for \"" << mPath << "\" never arrived!";
+		return;
+	}
+
+	if(isAtlased())
+		mAtlas->write(mAtlasRegion, dataRGBA.data());
+	else
+		createTexture(dataRGBA.data(), mTextureSize.x(), mTextureSize.y());
+}
+
+bool TextureResource::restoreShadowCopy()
+{
+	if(mTextureID != 0 || mShadowPixels.empty())
+		return false;
+
+	createTexture(mShadowPixels.data(), mTextureSize.x(), mTextureSize.y());
+	return true;
+}
+
+void TextureResource::createTexture(const unsigned char* dataRGBA, size_t width, size_t height)
+{
+	if(dataRGBA != mShadowPixels.data() && Settings::getInstance()->getBool("TextureShadowCopies"))
+		mShadowPixels.assign(dataRGBA, dataRGBA + width * height * 4);
+
 	//now for the openGL texture stuff
 	glGenTextures(1, &mTextureID);
-	glBindTexture(GL_TEXTURE_2D, mTextureID);
+	Renderer::bindTexture(mTextureID);
 
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, dataRGBA);
 
@@ -53,7 +205,58 @@ void TextureResource::initFromPixels(const unsigned char* dataRGBA, size_t width
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
 
-	mTextureSize << width, height;
+	// otherwise we stay on plain GL_LINEAR
+	if(mMipmap && (width > 1 || height > 1) && canMipmap(width, height))
+	{
+		GenerateMipmapProc generateMipmap = getGenerateMipmap();
+		if(generateMipmap)
+		{
+			generateMipmap(GL_TEXTURE_2D);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			mHasMipmaps = true;
+		}else{
+			// no driver support - build the chain on a worker and keep using plain GL_LINEAR until it's uploaded
+			// (dataRGBA may not outlive this call, so the worker gets its own copy)
+			std::vector<unsigned char> copy(dataRGBA, dataRGBA + width * height * 4);
+			mPendingMipmaps = ThreadPool::getInstance()->queue(std::bind(&TextureResource::buildMipmaps, std::move(copy), width, height));
+		}
+	}
+}
+
+std::vector<TextureResource::MipLevel> TextureResource::buildMipmaps(std::vector<unsigned char> dataRGBA, size_t width, size_t height)
+{
+	std::vector<MipLevel> levels;
+
+	while(width > 1 || height > 1)
+	{
+		const size_t newWidth = width > 1 ? width / 2 : 1;
+		const size_t newHeight = height > 1 ? height / 2 : 1;
+
+		MipLevel level;
+		level.data = ImageIO::scaleRGBA32(levels.empty() ? dataRGBA.data() : levels.back().data.data(), width, height, newWidth, newHeight);
+		level.width = newWidth;
+		level.height = newHeight;
+		levels.push_back(std::move(level));
+
+		width = newWidth;
+		height = newHeight;
+	}
+
+	return levels;
+}
+
+void TextureResource::uploadPendingMipmaps()
+{
+	if(!mPendingMipmaps.valid() || mPendingMipmaps.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return;
+
+	const std::vector<MipLevel> levels = mPendingMipmaps.get();
+	for(unsigned int i = 0; i < levels.size(); i++)
+		glTexImage2D(GL_TEXTURE_2D, i + 1, GL_RGBA, levels[i].width, levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[i].data.data());
+
+	// the chain is only complete now, switching earlier would leave the texture incomplete (and drawn black)
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	mHasMipmaps = true;
 }
 
 void TextureResource::initFromMemory(const char* data, size_t length)
@@ -67,16 +270,63 @@ void TextureResource::initFromMemory(const char* data, size_t length)
 		return;
 	}
 
+	// remember the decoded (and downscaled) image so next time we can skip decoding entirely
+	// scaling and writing happen on a worker (a big image is a lot of SD card writes), the texture gets the downscaled pixels when it's done
+	if(isDiskCached())
+	{
+		const Eigen::Vector2i maxSize = getDiskCacheMaxSize();
+		const Eigen::Vector2i scaledSize = TextureDiskCache::getScaledSize(Eigen::Vector2i((int)width, (int)height), maxSize);
+		initFromPixelsAsync(ThreadPool::getInstance()->queue(std::bind(&TextureResource::storeInDiskCache, mPath, maxSize, std::move(imageRGBA), width, height)),
+			scaledSize.x(), scaledSize.y());
+		return;
+	}
+
 	initFromPixels(imageRGBA.data(), width, height);
 }
 
+std::vector<unsigned char> TextureResource::storeInDiskCache(const std::string& path, const Eigen::Vector2i& maxSize, std::vector<unsigned char>& dataRGBA, size_t width, size_t height)
+{
+	TextureDiskCache::store(path, maxSize, dataRGBA, width, height);
+	return std::move(dataRGBA);
+}
+
+bool TextureResource::isDiskCached() const
+{
+	return !mPath.empty() && TextureDiskCache::isEnabled() && TextureDiskCache::isCacheable(mPath);
+}
+
+Eigen::Vector2i TextureResource::getDiskCacheMaxSize() const
+{
+	// tiled textures are drawn at their real size, so they must never be scaled
+	if(mTile)
+		return Eigen::Vector2i::Zero();
+
+	return Eigen::Vector2i(Renderer::getScreenWidth(), Renderer::getScreenHeight());
+}
+
 void TextureResource::deinit()
 {
+	mPendingPixels = std::future< std::vector<unsigned char> >();
+	mShadowPixels = std::vector<unsigned char>();
+
+	// a worker that's still running just finishes, its result is thrown away
+	mPendingMipmaps = std::future< std::vector<MipLevel> >();
+	mHasMipmaps = false;
+
 	if(mTextureID != 0)
 	{
-		glDeleteTextures(1, &mTextureID);
+		Renderer::deleteTexture(mTextureID);
 		mTextureID = 0;
 	}
+
+	if(mAtlas)
+	{
+		mAtlas->remove(mAtlasRegion);
+		mAtlasRegion = TextureAtlas::Region();
+		mAtlas.reset();
+	}
+
+	mTextureRect << 0, 0, 1, 1;
 }
 
 const Eigen::Vector2i& TextureResource::getSize() const
@@ -89,16 +339,49 @@ bool TextureResource::isTiled() const
 	return mTile;
 }
 
-void TextureResource::bind() const
+bool TextureResource::isMipmapped() const
 {
-	if(mTextureID != 0)
-		glBindTexture(GL_TEXTURE_2D, mTextureID);
-	else
+	return mMipmap;
+}
+
+bool TextureResource::isAtlased() const
+{
+	return mAtlasRegion.isValid();
+}
+
+GLuint TextureResource::getTextureID()
+{
+	uploadPendingPixels();
+
+	if(isAtlased())
+		return mAtlas->getTextureID(mAtlasRegion);
+
+	// drawing through Renderer::drawTriangles never calls bind(), so finished mipmaps are picked up here
+	if(mTextureID != 0 && mPendingMipmaps.valid())
+	{
+		Renderer::bindTexture(mTextureID);
+		uploadPendingMipmaps();
+	}
+
+	return mTextureID;
+}
+
+void TextureResource::bind()
+{
+	uploadPendingPixels();
+
+	if(isAtlased())
+		mAtlas->bind(mAtlasRegion);
+	else if(mTextureID != 0)
+	{
+		Renderer::bindTexture(mTextureID);
+		uploadPendingMipmaps();
+	}else
 		LOG(LogError) << "Tried to bind uninitialized texture!";
 }
 
 
-std::shared_ptr<TextureResource> TextureResource::get(const std::string& path, bool tile)
+std::shared_ptr<TextureResource> TextureResource::get(const std::string& path, bool tile, bool mipmap)
 {
 	std::shared_ptr<ResourceManager>& rm = ResourceManager::getInstance();
 
@@ -106,12 +389,25 @@ std::shared_ptr<TextureResource> TextureResource::get(const std::string& path, b
 
 	if(canonicalPath.empty())
 	{
-		std::shared_ptr<TextureResource> tex(new TextureResource("", tile));
+		std::shared_ptr<TextureResource> tex(new TextureResource("", tile, mipmap));
 		rm->addReloadable(tex); //make sure we get properly deinitialized even though we do nothing on reinitialization
 		return tex;
 	}
 
-	TextureKeyType key(canonicalPath, tile);
+	// SVGs are cached by SVGResource, per rasterized size
+	if(canonicalPath.size() >= 4 && canonicalPath.substr(canonicalPath.size() - 4, std::string::npos) == ".svg")
+	{
+		std::shared_ptr<TextureResource> svg = SVGResource::get(canonicalPath, tile, mipmap, 0, 0);
+		if(svg)
+			return svg;
+
+		// couldn't parse it, hand out an empty texture like we do for empty paths
+		std::shared_ptr<TextureResource> tex(new TextureResource("", tile, mipmap));
+		rm->addReloadable(tex);
+		return tex;
+	}
+
+	TextureKeyType key(canonicalPath, tile, mipmap);
 	auto foundTexture = sTextureMap.find(key);
 	if(foundTexture != sTextureMap.end())
 	{
@@ -120,40 +416,28 @@ std::shared_ptr<TextureResource> TextureResource::get(const std::string& path, b
 	}
 
 	// need to create it
-	std::shared_ptr<TextureResource> tex;
-
-	// is it an SVG?
-	if(key.first.substr(key.first.size() - 4, std::string::npos) == ".svg")
-	{
-		// probably
-		// don't add it to our map because 2 svgs might be rasterized at different sizes
-		tex = std::shared_ptr<SVGResource>(new SVGResource(key.first, tile));
-		sTextureList.push_back(tex); // add it to our list though
-		rm->addReloadable(tex);
-		tex->reload(rm);
-		return tex;
-	}else{
-		// normal texture
-		tex = std::shared_ptr<TextureResource>(new TextureResource(key.first, tile));
-		sTextureMap[key] = std::weak_ptr<TextureResource>(tex);
-		sTextureList.push_back(tex);
-		rm->addReloadable(tex);
-		tex->reload(ResourceManager::getInstance());
-		return tex;
-	}
+	std::shared_ptr<TextureResource> tex(new TextureResource(canonicalPath, tile, mipmap));
+	sTextureMap[key] = std::weak_ptr<TextureResource>(tex);
+	sTextureList.push_back(tex);
+	rm->addReloadable(tex);
+	tex->reload(ResourceManager::getInstance());
+	return tex;
 }
 
 bool TextureResource::isInitialized() const
 {
-	return mTextureID != 0;
+	return mTextureID != 0 || isAtlased() || mPendingPixels.valid() || !mShadowPixels.empty();
 }
 
 size_t TextureResource::getMemUsage() const
 {
+	// atlased textures are counted as part of their atlas page
 	if(!mTextureID || mTextureSize.x() == 0 || mTextureSize.y() == 0)
 		return 0;
 
-	return mTextureSize.x() * mTextureSize.y() * 4;
+	// a full mipmap chain adds another third
+	const size_t size = mTextureSize.x() * mTextureSize.y() * 4;
+	return mHasMipmaps ? size + size / 3 : size;
 }
 
 size_t TextureResource::getTotalMemUsage()
@@ -174,5 +458,7 @@ size_t TextureResource::getTotalMemUsage()
 		it++;
 	}
 
+	total += TextureAtlas::getInstance()->getMemUsage();
+
 	return total;
 }
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "resources/ResourceManager.h"
+#include "resources/TextureAtlas.h"
 
 #include <string>
+#include <vector>
+#include <future>
+#include <tuple>
 #include <Eigen/Dense>
 #include "platform.h"
 #include GLHEADER
@@ -12,7 +16,8 @@
 class TextureResource : public IReloadable
 {
 public:
-	static std::shared_ptr<TextureResource> get(const std::string& path, bool tile = false);
+	// If mipmap is true, a full mipmap chain is built and the texture is sampled trilinearly (for images that are drawn much smaller than they are).
+	static std::shared_ptr<TextureResource> get(const std::string& path, bool tile = false, bool mipmap = false);
 
 	virtual ~TextureResource();
 
@@ -21,8 +26,18 @@ public:
 	
 	bool isInitialized() const;
 	bool isTiled() const;
+	bool isMipmapped() const;
+	bool isAtlased() const; // small, untiled textures are packed into a shared TextureAtlas page
 	const Eigen::Vector2i& getSize() const;
-	void bind() const;
+	void bind();
+	GLuint getTextureID(); // the GL texture bind() binds - textures in the same atlas page share it
+
+	// Maps texture coordinates of this image ((0, 0) to (1, 1)) to coordinates in the GL texture.
+	// They are only different for atlased textures, so don't use it with tiled coordinates (tiled textures are never atlased).
+	inline Eigen::Vector2f mapTexCoord(const Eigen::Vector2f& coord) const
+	{
+		return Eigen::Vector2f(mTextureRect.x() + coord.x() * (mTextureRect.z() - mTextureRect.x()), mTextureRect.y() + coord.y() * (mTextureRect.w() - mTextureRect.y()));
+	}
 	
 	// Warning: will NOT correctly reinitialize when this texture is reloaded (e.g. ES starts/stops playing a game).
 	virtual void initFromMemory(const char* file, size_t length);
@@ -30,22 +45,57 @@ public:
 	// Warning: will NOT correctly reinitialize when this texture is reloaded (e.g. ES starts/stops playing a game).
 	void initFromPixels(const unsigned char* dataRGBA, size_t width, size_t height);
 
+	// Like initFromPixels, but the pixels are still being made (e.g. on a ThreadPool worker).
+	// The size is known right away, the pixels are uploaded the first time the texture is bound (waiting for them if needed).
+	void initFromPixelsAsync(std::future< std::vector<unsigned char> > dataRGBA, size_t width, size_t height);
+
 	size_t getMemUsage() const; // returns an approximation of the VRAM used by this texture (in bytes)
 	static size_t getTotalMemUsage(); // returns an approximation of total VRAM used by textures (in bytes)
 
 protected:
-	TextureResource(const std::string& path, bool tile);
+	TextureResource(const std::string& path, bool tile, bool mipmap = false);
 	void deinit();
+	bool restoreShadowCopy(); // recreates the GL texture from the shadow copy if it was unloaded, returns false if there's nothing to restore
+
+	bool isDiskCached() const;
+	Eigen::Vector2i getDiskCacheMaxSize() const; // textures are downscaled to fit the screen before being cached
 
 	Eigen::Vector2i mTextureSize;
 	const std::string mPath;
 	const bool mTile;
+	const bool mMipmap;
+
+	static std::list< std::weak_ptr<TextureResource> > sTextureList; // list of all textures, used for memory approximations
 
 private:
+	struct MipLevel
+	{
+		std::vector<unsigned char> data;
+		size_t width;
+		size_t height;
+	};
+
+	// Builds levels 1..n by repeatedly halving the image. Runs on a worker thread when the driver can't generate mipmaps itself.
+	static std::vector<MipLevel> buildMipmaps(std::vector<unsigned char> dataRGBA, size_t width, size_t height);
+	// Runs on a worker for initFromMemory: stores the image in the disk cache and returns its pixels, downscaled like the cached ones.
+	static std::vector<unsigned char> storeInDiskCache(const std::string& path, const Eigen::Vector2i& maxSize, std::vector<unsigned char>& dataRGBA, size_t width, size_t height);
+	void uploadPendingMipmaps(); // uploads the worker's mipmaps once they're done
+	void uploadPendingPixels(); // see initFromPixelsAsync
+
+	void createTexture(const unsigned char* dataRGBA, size_t width, size_t height);
+
+	// textures keep a CPU copy of their pixels if the TextureShadowCopies setting is on, so restoring them after a game doesn't need the file again
+	std::vector<unsigned char> mShadowPixels;
+
 	GLuint mTextureID;
+	std::shared_ptr<TextureAtlas> mAtlas; // kept so the atlas outlives us
+	TextureAtlas::Region mAtlasRegion;
+	Eigen::Vector4f mTextureRect; // where we are in the GL texture (min x, min y, max x, max y)
 
-	typedef std::pair<std::string, bool> TextureKeyType;
-	static std::map< TextureKeyType, std::weak_ptr<TextureResource> > sTextureMap; // map of textures, used to prevent duplicate textures
+	std::future< std::vector<unsigned char> > mPendingPixels;
+	std::future< std::vector<MipLevel> > mPendingMipmaps;
+	bool mHasMipmaps;
 
-	static std::list< std::weak_ptr<TextureResource> > sTextureList; // list of all textures, used for memory approximations
+	typedef std::tuple<std::string, bool, bool> TextureKeyType; // path, tile, mipmap
+	static std::map< TextureKeyType, std::weak_ptr<TextureResource> > sTextureMap; // map of textures, used to prevent duplicate textures (SVGs have their own, see SVGResource)
 };